@@ -28,7 +28,15 @@ entity game_test is
     p2_y     : out unsigned(F4_UPPER downto 0);
     p1_score : out signed(15 downto 0);
     p2_score : out signed(15 downto 0);
-    age      : out unsigned(15 downto 0)
+    age      : out unsigned(15 downto 0);
+
+    -- extra state for checking against the CPU game
+    p1_x_vel : out signed(15 downto 0); -- raw f4 bits
+    p1_y_vel : out signed(15 downto 0);
+    p2_x_vel : out signed(15 downto 0);
+    p2_y_vel : out signed(15 downto 0);
+    coin_x   : out unsigned(MAP_TILES_BITS - 1 downto 0);
+    coin_y   : out unsigned(MAP_TILES_BITS - 1 downto 0)
   );
 end entity game_test;
 
@@ -45,6 +53,12 @@ begin
   p1_score <= gamestate.p1.score;
   p2_score <= gamestate.p2.score;
   age      <= gamestate.age;
+  p1_x_vel <= signed(to_slv(gamestate.p1.vel.x));
+  p1_y_vel <= signed(to_slv(gamestate.p1.vel.y));
+  p2_x_vel <= signed(to_slv(gamestate.p2.vel.x));
+  p2_y_vel <= signed(to_slv(gamestate.p2.vel.y));
+  coin_x   <= gamestate.coin_pos.x;
+  coin_y   <= gamestate.coin_pos.y;
 
   -- instantiate
   g : entity work.game
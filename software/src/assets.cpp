@@ -0,0 +1,60 @@
+#include "assets.h"
+
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "lodepng.h"
+
+#ifdef JNB_EMBED_ASSETS
+#include "tiles_png.h" // generated by CMake, defines TILES_PNG
+#endif
+
+namespace assets {
+
+namespace {
+
+std::shared_ptr<const Image> load_spritesheet() {
+  auto image = std::make_shared<Image>();
+#ifdef JNB_EMBED_ASSETS
+  auto error = lodepng::decode(image->pixels, image->width, image->height, TILES_PNG,
+                               sizeof(TILES_PNG));
+#else
+  auto error = lodepng::decode(image->pixels, image->width, image->height, "tiles.png");
+#endif
+  if (error) {
+    std::cerr << "Error loading spritesheet: " << lodepng_error_text(error) << std::endl;
+    throw std::runtime_error("Failed to load spritesheet");
+  }
+  return image;
+}
+
+} // namespace
+
+std::shared_ptr<const Image> get_spritesheet() {
+  // a failed load throws out of the initializer, so the next call tries again
+  static const std::shared_ptr<const Image> spritesheet = load_spritesheet();
+  return spritesheet;
+}
+
+std::shared_ptr<const jnb::MapData> get_map(const std::string &filename) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::shared_ptr<const jnb::MapData>> maps;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = maps.find(filename);
+  if (it != maps.end()) {
+    return it->second;
+  }
+  jnb::TileMap tile_map;
+  if (!tile_map.load_from_file(filename)) {
+    // nothing is cached, so the next call tries again
+    throw std::runtime_error("Failed to load map: " + filename);
+  }
+  auto map = std::make_shared<const jnb::MapData>(tile_map);
+  maps.emplace(filename, map);
+  return map;
+}
+
+} // namespace assets
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "jnb.h"
+
+// process-wide cache of everything games load from disk. each asset is loaded once on first use
+// and shared read-only from then on, so constructing games in bulk costs no file io.
+// safe to call from multiple threads.
+namespace assets {
+
+struct Image {
+  uint32_t width{0};
+  uint32_t height{0};
+  std::vector<uint8_t> pixels{}; // RGBA, row major
+};
+
+// tiles.png, one CELL_SIZE square tile per Tile value (minus one) from top to bottom.
+// compiled into the binary when built with JNB_EMBED_ASSETS, otherwise read from the working
+// directory. throws std::runtime_error if it can't be loaded.
+std::shared_ptr<const Image> get_spritesheet();
+
+// the map in filename, keyed by the filename as given. throws std::runtime_error if it can't be
+// loaded, failures aren't cached.
+std::shared_ptr<const jnb::MapData> get_map(const std::string &filename);
+
+} // namespace assets
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+
+#include "parse_map.h"
+
+namespace jnb {
+
+// compiled, read-only form of a TileMap for collision queries.
+// every tile class the physics cares about gets its own set of y-up row bitmasks, so a query
+// is a row load, a shift and an AND instead of a bounds-checked, y-flipped read_map.
+// rows have a padding row below and above the map, and columns have padding on both sides,
+// so clamped out-of-bounds coordinates read the same thing read_map returns
+// (GROUND left, right and below the map, AIR above it).
+// the same bits are also unpacked to one byte per tile (cell), for the wide kernels in
+// jnb_simd.h, which gather a tile's classes per lane instead of shifting rows.
+// TileMap stays the editable source; rebuild after changing it.
+class CollisionMap {
+public:
+  enum Layer { SOLID, WATER, ICE, SPRING, LAYER_COUNT };
+
+  // map rows plus one padding row on each side. row index is y + 1.
+  static constexpr int ROW_COUNT = MAP_MAX_SIZE_TILES + 2;
+  // columns -1 up to MAX_COLUMN fit in a row word, column x is bit x + 1.
+  // rows are 32 bits wide so the padding columns fit next to the 16 map columns.
+  static constexpr int MAX_COLUMN = 30;
+  // cells per row, columns -1 up to MAX_COLUMN
+  static constexpr int COLUMN_COUNT = MAX_COLUMN + 2;
+  // bytes after the last cell, so a cell can be gathered as the low byte of a 32 bit load
+  static constexpr int CELL_PADDING = 3;
+
+  constexpr CollisionMap() = default;
+  constexpr explicit CollisionMap(const TileMap &map) {
+    build(map);
+  }
+
+  constexpr void build(const TileMap &map) {
+    if (map.width > static_cast<int>(MAP_MAX_SIZE_TILES) ||
+        map.height > static_cast<int>(MAP_MAX_SIZE_TILES)) {
+      throw std::runtime_error("Map is larger than MAP_MAX_SIZE_TILES");
+    }
+    for (int y = -1; y <= static_cast<int>(MAP_MAX_SIZE_TILES); ++y) {
+      uint32_t solid = 0, water = 0, ice = 0, spring = 0;
+      for (int x = -1; x <= MAX_COLUMN; ++x) {
+        const Tile tile = map.read_map(x, y);
+        const uint32_t bit = uint32_t{1} << (x + 1);
+        solid |= is_solid(tile) ? bit : 0;
+        water |= is_water(tile) ? bit : 0;
+        ice |= tile == Tile::ICE ? bit : 0;
+        spring |= tile == Tile::SPRING ? bit : 0;
+      }
+      rows[SOLID][y + 1] = solid;
+      rows[WATER][y + 1] = water;
+      rows[ICE][y + 1] = ice;
+      rows[SPRING][y + 1] = spring;
+    }
+
+    // cells are derived from the rows, so both forms always agree
+    for (int r = 0; r < ROW_COUNT; ++r) {
+      for (int c = 0; c < COLUMN_COUNT; ++c) {
+        uint8_t bits = 0;
+        for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+          bits |= static_cast<uint8_t>(((rows[layer][r] >> c) & 1) << layer);
+        }
+        cells[r * COLUMN_COUNT + c] = bits;
+      }
+    }
+  }
+
+  // the coordinates queries actually read, out-of-bounds ones land on the padding
+  static constexpr int clamp_x(int x) {
+    return std::clamp(x, -1, MAX_COLUMN);
+  }
+  static constexpr int clamp_y(int y) {
+    return std::clamp(y, -1, static_cast<int>(MAP_MAX_SIZE_TILES));
+  }
+
+  // bitmask of a whole row, column x is bit x + 1
+  constexpr uint32_t row(Layer layer, int y) const {
+    return rows[layer][clamp_y(y) + 1];
+  }
+
+  constexpr bool test(Layer layer, int x, int y) const {
+    return (row(layer, y) >> (clamp_x(x) + 1)) & 1;
+  }
+
+  // true if either of two columns in the same row is set
+  constexpr bool test_any(Layer layer, int x1, int x2, int y) const {
+    const uint32_t r = row(layer, y);
+    return ((r >> (clamp_x(x1) + 1)) | (r >> (clamp_x(x2) + 1))) & 1;
+  }
+
+  // index of tile (x, y) in cell_data()
+  static constexpr int cell_index(int x, int y) {
+    return (clamp_y(y) + 1) * COLUMN_COUNT + clamp_x(x) + 1;
+  }
+
+  // every layer of one tile, bit `layer` set if the tile is in it
+  constexpr uint8_t cell(int x, int y) const {
+    return cells[cell_index(x, y)];
+  }
+
+  const uint8_t *cell_data() const {
+    return cells.data();
+  }
+
+private:
+  std::array<std::array<uint32_t, ROW_COUNT>, LAYER_COUNT> rows{};
+  std::array<uint8_t, ROW_COUNT * COLUMN_COUNT + CELL_PADDING> cells{};
+};
+
+} // namespace jnb
@@ -113,9 +113,7 @@ void send(const PlayerInput &player_input, const set_uart_fun &send_fun) {
   // bit 0 is left
   // bit 1 is right
   // bit 2 is jump
-  uint8_t msg = (player_input.left ? 0x01 : 0) | (player_input.right ? 0x02 : 0) |
-                (player_input.jump ? 0x04 : 0);
-  send_fun(msg);
+  send_fun(pack_input(player_input));
 }
 
 std::optional<msg_obj> receive(const get_uart_blocking_fun &get_fun_blocking,
@@ -30,8 +30,6 @@ template <class... Ts> Overload(Ts...) -> Overload<Ts...>;
 using msg_obj = std::variant<GameState, GAStatus, std::uint8_t, std::vector<std::uint8_t>>;
 
 constexpr size_t MAX_POPULATION_SIZE = 128;
-constexpr size_t MAP_MAX_SIZE_BITS = 4;
-constexpr size_t MAP_MAX_SIZE_TILES = 1 << MAP_MAX_SIZE_BITS;
 
 constexpr size_t MAP_MAX_SPAWNS = MAP_MAX_SIZE_TILES * MAP_MAX_SIZE_TILES / 2;
 
@@ -0,0 +1,30 @@
+#include "cpu_isa.h"
+
+namespace cpu {
+
+Isa detect_isa() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+    return Isa::AVX512;
+  }
+  // every avx2 cpu has fma, the check is for emulators that only report one
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return Isa::AVX2;
+  }
+#endif
+  return Isa::SCALAR;
+}
+
+const char *isa_name(Isa isa) {
+  switch (isa) {
+    case Isa::AVX2:
+      return "AVX2";
+    case Isa::AVX512:
+      return "AVX-512";
+    default:
+      return "scalar";
+  }
+}
+
+} // namespace cpu
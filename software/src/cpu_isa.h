@@ -0,0 +1,12 @@
+#pragma once
+
+// instruction sets the hand-vectorized kernels are compiled for, picked at runtime
+namespace cpu {
+
+enum class Isa { SCALAR, AVX2, AVX512 };
+
+// best kernel the host cpu can run. SCALAR when no wide kernel was compiled in.
+Isa detect_isa();
+const char *isa_name(Isa isa);
+
+} // namespace cpu
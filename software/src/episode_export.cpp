@@ -0,0 +1,36 @@
+#include "episode_export.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "lodepng.h"
+
+namespace episode_export {
+
+void lower_thread_priority() {
+#ifdef _WIN32
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#else
+  // linux keeps a nice value per thread, so this doesn't touch the rest of the process
+  setpriority(PRIO_PROCESS, 0, 19);
+#endif
+}
+
+bool write_png(const std::string &filename, const std::vector<uint32_t> &pixels, int width,
+               int height) {
+  // make_color puts r in the low byte, so the pixels are already RGBA bytes in memory
+  auto error = lodepng::encode(filename, reinterpret_cast<const unsigned char *>(pixels.data()),
+                               width, height);
+  if (error) {
+    std::cerr << "Failed to write " << filename << ": " << lodepng_error_text(error) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace episode_export
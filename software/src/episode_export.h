@@ -0,0 +1,144 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "game.h"
+#include "models/model.h"
+
+namespace episode_export {
+
+// drop the calling thread to the lowest scheduling priority
+void lower_thread_priority();
+
+// write RGBA pixels (as packed by rendering::make_color) to a PNG file, prints why on failure
+bool write_png(const std::string &filename, const std::vector<uint32_t> &pixels, int width,
+               int height);
+
+} // namespace episode_export
+
+// plays and records episodes to PNG frame sequences on a low priority background thread, without
+// a window. the caller only clones the game and models, so it can be used from a training loop.
+template <typename ObsType>
+class EpisodeExporter {
+public:
+  // at most max_queued episodes wait for the worker, further ones are dropped
+  explicit EpisodeExporter(size_t max_queued = 4) : max_queued(max_queued) {
+    worker = std::thread([this]() { work(); });
+  }
+
+  // finishes everything already queued
+  ~EpisodeExporter() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+  }
+
+  EpisodeExporter(const EpisodeExporter &) = delete;
+  EpisodeExporter &operator=(const EpisodeExporter &) = delete;
+
+  // play models on a clone of game from its current state until it is done or max_frames have
+  // been played, writing each frame to directory/frame_NNNNN.png. returns false if the queue is
+  // full, in which case the episode is dropped.
+  bool submit(const Game<ObsType> &game,
+              const std::vector<std::shared_ptr<model::Model<ObsType>>> &models,
+              const std::string &directory, int max_frames = 10000) {
+    // clone outside the lock, models can be large
+    Job job{game.clone(), {}, directory, max_frames};
+    for (const auto &m : models) {
+      job.models.push_back(m->clone());
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (jobs.size() >= max_queued) {
+        return false;
+      }
+      jobs.push_back(std::move(job));
+    }
+    wake.notify_one();
+    return true;
+  }
+
+private:
+  struct Job {
+    std::unique_ptr<Game<ObsType>> game;
+    std::vector<std::shared_ptr<model::Model<ObsType>>> models;
+    std::string directory;
+    int max_frames;
+  };
+
+  void work() {
+    // stay out of the way of training threads
+    episode_export::lower_thread_priority();
+
+    while (true) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+        if (jobs.empty()) {
+          return;
+        }
+        job = std::move(jobs.front());
+        jobs.pop_front();
+      }
+      export_episode(job);
+    }
+  }
+
+  static void export_episode(Job &job) {
+    Game<ObsType> &game = *job.game;
+    std::error_code error;
+    std::filesystem::create_directories(job.directory, error);
+    if (error) {
+      std::cerr << "Failed to create " << job.directory << ": " << error.message() << std::endl;
+      return;
+    }
+
+    std::vector<ObsType> inputs = game.build_observation();
+    std::vector<std::vector<float>> outputs(game.get_player_count(),
+                                            std::vector<float>(game.get_action_count()));
+    std::vector<uint32_t> pixels;
+    rendering::RenderTarget target;
+
+    // the first frame is the starting state
+    for (int frame = 0;; ++frame) {
+      const auto [width, height] = game.get_resolution();
+      game.render(pixels, target);
+      char name[32];
+      std::snprintf(name, sizeof(name), "frame_%05d.png", frame);
+      const std::string filename = (std::filesystem::path(job.directory) / name).string();
+      if (!episode_export::write_png(filename, pixels, width, height)) {
+        return;
+      }
+
+      if (game.is_done() || frame >= job.max_frames) {
+        break;
+      }
+      game.observe(inputs);
+      for (size_t i = 0; i < job.models.size(); ++i) {
+        job.models[i]->forward(inputs[i], outputs[i]);
+      }
+      game.update(outputs);
+    }
+  }
+
+  size_t max_queued;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<Job> jobs{};
+  bool stopping{false};
+  std::thread worker;
+};
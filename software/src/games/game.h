@@ -6,6 +6,8 @@
 #include <utility>
 #include <vector>
 
+#include "rendering.h"
+
 template <typename ObsType>
 class Game {
 public:
@@ -26,6 +28,9 @@ public:
   // Get fitness for all players (filled into the provided vector)
   virtual void get_fitness(std::vector<int32_t> &fitness) = 0;
 
+  // Get the episode length limit in frames, negative means unlimited
+  virtual int get_frame_limit() = 0;
+
   // Check if game is finished
   virtual bool is_done() = 0;
 
@@ -38,12 +43,35 @@ public:
   // Get the game name (for logging/identification)
   virtual std::string get_name() = 0;
 
-  // Render the game state to a pixel buffer
+  // Render the game state to a pixel buffer, all of it
   virtual void render(std::vector<uint32_t> &pixels) = 0;
 
+  // Render into a buffer that holds the frame last rendered with target, so a game can redraw
+  // just what changed. by default the whole frame is drawn
+  virtual void render(std::vector<uint32_t> &pixels, rendering::RenderTarget &target) {
+    target = {};
+    render(pixels);
+  }
+
   // Get the rendering resolution (width, height)
   virtual std::pair<int, int> get_resolution() = 0;
 
   // Clone the game state (deep copy)
   virtual std::unique_ptr<Game<ObsType>> clone() const = 0;
+
+  // Copy the mutable game state into a caller-owned buffer (resized if needed, so reusing
+  // the buffer avoids allocation). Immutable data such as the map is not included.
+  virtual void snapshot(std::vector<uint8_t> &buffer) const = 0;
+
+  // Rewind to a snapshot taken from this game or a clone of it
+  virtual void restore(const std::vector<uint8_t> &buffer) = 0;
+
+  // Start recording the episode from the current frame into a replay file, written by
+  // end_replay() or the next init(). Returns false if the game has no replay support.
+  virtual bool begin_replay(const std::string &filename) {
+    return false;
+  }
+
+  // Write out the replay started by begin_replay(), if any
+  virtual void end_replay() {}
 };
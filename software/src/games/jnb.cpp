@@ -1,12 +1,15 @@
 #include "jnb.h"
 
-#include "lodepng.h"
-
+#include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <functional>
+#include <cstring>
 #include <vector>
 
+#include "assets.h"
+#include "jnb_replay.h"
+#include "jnb_step.h"
+#include "param_hash.h"
 #include "rendering.h"
 
 namespace jnb {
@@ -15,257 +18,6 @@ namespace jnb {
 // out-of-bounds down, left, right returns GROUND.
 // out-of-bounds up returns AIR.
 
-TilePos get_random_spawn_pos(std::mt19937 &rng, const TileMap &map) {
-  std::uniform_int_distribution<int> dist(0, map.spawns.size() - 1);
-  auto coin_pos_index = dist(rng);
-  return map.spawns[coin_pos_index];
-}
-
-int get_tile_id(int pos) {
-  if (pos >= 0) {
-    return pos / CELL_SIZE;
-  } else {
-    // in our case, just returning -1 here is fine, since the player will never
-    // make it past -1 in any case.
-    return -1;
-  }
-}
-
-// building the phases as lambdas within a function so that I can create and capture
-// some variables that otherwise would have to be re-computed, or passed, to each phase.
-// TODO: on fpga we might be able to mash these phases together, because we can update
-// velocity without it taking effect immediately (i.e., we only see that register change
-// on the next cycle).
-std::vector<std::function<void(Player &, const Player &, const PlayerInput &, bool &)>>
-make_player_phases(const Player &_p, GameState &state) {
-  // these values will be computed combinatorially on FPGA
-
-  // x_low and y_low is the bottom left of the player, in pixels
-  const int x_low = _p.x.to_integer_floor();
-  const int y_low = _p.y.to_integer_floor();
-
-  const int x_tile_left = get_tile_id(x_low); // tile x coord containing left side of player
-  const int x_tile_right =
-      get_tile_id(x_low + PLAYER_WIDTH - 1);  // tile y coord containing right side of player
-  const int y_tile_down = get_tile_id(y_low); // tile y coord containing bottom of player
-  const int y_tile_up =
-      get_tile_id(y_low + PLAYER_HEIGHT - 1); // tile y coord containing top of player
-
-  // have the tile coordinates, now we can retrieve the tiles we care about
-  const Tile left_tile = state.map.read_map(x_tile_left, y_tile_down); // tile our left foot is in
-  const Tile right_tile =
-      state.map.read_map(x_tile_right, y_tile_down); // tile our right foot is in
-  const Tile down_left_tile =
-      state.map.read_map(x_tile_left, y_tile_down - 1); // tile below left_tile
-  const Tile down_right_tile =
-      state.map.read_map(x_tile_right, y_tile_down - 1); // tile below right_tile
-
-  auto phase1 = [=, &state](Player &p, const Player &other, const PlayerInput &input,
-                            bool &coin_collected) {
-    // early return if dead
-    if (p.dead_timeout > 0)
-      return;
-    // determine if the player is grounded
-    bool grounded = false;
-    if (F4(static_cast<int16_t>(y_tile_down * CELL_SIZE)) == p.y) {
-      // we are on the bottom of a tile,
-      // so check if we are on something stand-able...
-      if (is_solid(down_left_tile) || is_solid(down_right_tile)) {
-        grounded = true;
-      }
-    }
-
-    // determine if in water
-    const bool in_water = is_water(left_tile) || is_water(right_tile);
-    // determine if on ice
-    const bool on_ice = down_left_tile == Tile::ICE || down_right_tile == Tile::ICE;
-    // determine acceleration based on context
-    const F4 gravity = in_water ? GRAVITY_WATER : GRAVITY;
-    const F4 move_accel = on_ice ? MOVE_ACCEL_ICE : (in_water ? MOVE_ACCEL_WATER : MOVE_ACCEL);
-
-    // jump logic
-    if (grounded) {
-      if (down_left_tile == Tile::SPRING || down_right_tile == Tile::SPRING) {
-        p.y_vel = SPRING_VEL;
-      } else if (input.jump) {
-        p.y_vel = JUMP_VEL;
-      }
-    } else { // not grounded. accelerate due to gravity
-      p.y_vel += gravity;
-      // if jump is held, also accelerate up a little to 'float'
-      if (input.jump) {
-        p.y_vel += JUMP_MIDAIR_ACCEL;
-      }
-      // limit y_vel
-      if (p.y_vel < FALL_MAX_VEL) {
-        p.y_vel = FALL_MAX_VEL;
-      }
-    }
-
-    // accelerate x_vel based on input
-    if (input.left && !input.right) {
-      // accel left
-      p.x_vel -= move_accel;
-    } else if (input.right && !input.left) {
-      // accel right
-      p.x_vel += move_accel;
-    } else {
-      // decelerate towards zero if grounded and not on ice
-      if (grounded && !on_ice) {
-        if (p.x_vel > F4_ZERO) {
-          // check if we have room to do the full speed reduction
-          if (p.x_vel >= move_accel) {
-            p.x_vel -= move_accel;
-          } else {
-            // we are too slow to do the full speed reduction
-            p.x_vel = F4_ZERO;
-          }
-        } else if (p.x_vel < F4_ZERO) {
-          // check if we have room to do the full speed reduction
-          if (p.x_vel <= -move_accel) {
-            p.x_vel += move_accel;
-          } else {
-            // we are too slow to do the full speed reduction
-            p.x_vel = F4_ZERO;
-          }
-        }
-      }
-    }
-
-    // limit x velocity
-    if (p.x_vel < -MOVE_MAX_VEL) {
-      p.x_vel = -MOVE_MAX_VEL;
-    }
-    if (p.x_vel > MOVE_MAX_VEL) {
-      p.x_vel = MOVE_MAX_VEL;
-    }
-
-    // accelerate based on collision with other player
-    // just push away in the horizontal axis during collision
-    // HACK: because these phases run sequentially on CPU,
-    // this player might die and be skipped by the next phase, which
-    // is asymmetric
-    if (other.dead_timeout == 0) { // only run if opponent is alive
-      if ((p.y - other.y).abs() < F4(static_cast<int16_t>(PLAYER_HEIGHT))) {
-        if ((p.x - other.x).abs() <= F4(static_cast<int16_t>(PLAYER_WIDTH))) {
-          bool accel = true;
-          // if other player is significantly above this one, die
-          if (other.y >= p.y + F4(static_cast<int16_t>(PLAYER_KILL_HEIGHT))) {
-            p.queue_dead = true;
-          }
-          // if the opposite is true, gain a point
-          else if (p.y >= other.y + F4(static_cast<int16_t>(PLAYER_KILL_HEIGHT))) {
-            p.score += POINTS_PER_KILL;
-            accel = false;
-          }
-          if (accel) {
-            if (p.x > other.x) {
-              p.x_vel += (other.x - p.x + F4(static_cast<int16_t>(PLAYER_WIDTH)));
-            } else if (p.x < other.x) {
-              p.x_vel += (other.x - p.x - F4(static_cast<int16_t>(PLAYER_WIDTH)));
-            }
-          }
-        }
-      }
-    }
-  };
-
-  auto phase2 = [=, &state](Player &p, const Player &other, const PlayerInput &input,
-                            bool &coin_collected) {
-    // early return if dead
-    if (p.dead_timeout > 1) {
-      p.dead_timeout--;
-      return;
-    } else if (p.dead_timeout == 1) {
-      p.dead_timeout--;
-      // respawn
-      auto tile_pos = get_random_spawn_pos(state.rng, state.map);
-      p.x = F4(static_cast<int16_t>(tile_pos.x * CELL_SIZE));
-      p.y = F4(static_cast<int16_t>(tile_pos.y * CELL_SIZE));
-      p.x_vel = F4_ZERO;
-      p.y_vel = F4_ZERO;
-    }
-
-    // integrate velocity
-    p.x += p.x_vel;
-    p.y += p.y_vel;
-
-    // handle collisions against solid tiles
-    const int xn_low = p.x.to_integer_floor();
-    const int yn_low = p.y.to_integer_floor();
-
-    const int xn_tile_left = get_tile_id(xn_low);
-    const int xn_tile_right = get_tile_id(xn_low + PLAYER_WIDTH - 1);
-    const int yn_tile_down = get_tile_id(yn_low);
-    const int yn_tile_up = get_tile_id(yn_low + PLAYER_HEIGHT - 1);
-
-    // handle left right collisions
-    if (p.x_vel < F4_ZERO) {
-      // going left. check left side
-      const Tile left_1 = state.map.read_map(xn_tile_left, y_tile_down);
-      const Tile left_2 = state.map.read_map(xn_tile_left, y_tile_up);
-      if (is_solid(left_1) || is_solid(left_2)) {
-        // make flush with wall
-        p.x = F4(static_cast<int16_t>((xn_tile_left + 1) * CELL_SIZE));
-        // cancel velocity
-        p.x_vel = F4_ZERO;
-      }
-    } else if (p.x_vel > F4_ZERO) {
-      // going right. check right side
-      const Tile right_1 = state.map.read_map(xn_tile_right, y_tile_down);
-      const Tile right_2 = state.map.read_map(xn_tile_right, y_tile_up);
-      if (is_solid(right_1) || is_solid(right_2)) {
-        // make flush with wall
-        p.x = F4(static_cast<int16_t>(xn_tile_right * CELL_SIZE - PLAYER_WIDTH));
-        // cancel velocity
-        p.x_vel = F4_ZERO;
-      }
-    }
-    if (p.y_vel < F4_ZERO) {
-      // going down. check bottom
-      const Tile down_1 = state.map.read_map(x_tile_left, yn_tile_down);
-      const Tile down_2 = state.map.read_map(x_tile_right, yn_tile_down);
-      if (is_solid(down_1) || is_solid(down_2)) {
-        // make flush with floor
-        p.y = F4(static_cast<int16_t>((yn_tile_down + 1) * CELL_SIZE));
-        // cancel velocity
-        p.y_vel = F4_ZERO;
-      }
-    } else if (p.y_vel > F4_ZERO) {
-      // going up. check top
-      const Tile top_1 = state.map.read_map(x_tile_left, yn_tile_up);
-      const Tile top_2 = state.map.read_map(x_tile_right, yn_tile_up);
-      if (is_solid(top_1) || is_solid(top_2)) {
-        p.y = F4(static_cast<int16_t>(yn_tile_up * CELL_SIZE - PLAYER_HEIGHT));
-        // cancel velocity
-        p.y_vel = F4_ZERO;
-      }
-    }
-
-    // check coin collision.
-    // can do this in here (which would be both players in parallel in FPGA) because
-    // in the edge case where both players collide with the coin on the same frame,
-    // we'll just give both of them the point.
-    const int x_center = p.x.to_integer_rounded() + PLAYER_WIDTH / 2;
-    const int y_center = p.y.to_integer_rounded() + PLAYER_HEIGHT / 2;
-    const int x_tile_center = get_tile_id(x_center);
-    const int y_tile_center = get_tile_id(y_center);
-    coin_collected = x_tile_center == state.coin_pos.x && y_tile_center == state.coin_pos.y;
-    if (coin_collected) {
-      // get a point for collecting coin
-      p.score += POINTS_PER_COIN;
-    }
-
-    // if death was queued, die
-    if (p.queue_dead) {
-      p.queue_dead = false;
-      p.dead_timeout = DEAD_TIMEOUT;
-    }
-  };
-
-  return {phase1, phase2};
-}
-
 void observe_state_simple(const GameState &state, std::vector<F4> &observation,
                           bool p1_perspective) {
   observation.resize(SIMPLE_INPUT_COUNT);
@@ -293,36 +45,51 @@ void observe_state_simple(const GameState &state, std::vector<F4> &observation,
   observation[index++] = second.y_vel;
 }
 
-void observe_state_simple(const GameState &state, std::vector<float> &observation,
-                          bool p1_perspective) {
-  const float x_norm = 1.0f / (state.map.width * CELL_SIZE);
-  const float y_norm = 1.0f / (state.map.height * CELL_SIZE);
-  const float x_vel_norm = 1.0f / (MOVE_MAX_VEL.to_float());
-  const float y_vel_norm = 1.0f / (-FALL_MAX_VEL.to_float());
+ObsNorm::ObsNorm(const TileMap &map)
+    : x(1.0f / (map.width * CELL_SIZE)), y(1.0f / (map.height * CELL_SIZE)),
+      x_vel(1.0f / (MOVE_MAX_VEL.to_float())), y_vel(1.0f / (-FALL_MAX_VEL.to_float())) {}
 
+void observe_state_simple(const TileMap &map, const GameState &state,
+                          std::vector<float> &observation, bool p1_perspective) {
   observation.resize(SIMPLE_INPUT_COUNT);
+  observe_state_simple(ObsNorm(map), state, observation.data(), p1_perspective);
+}
+
+void observe_state_simple(const ObsNorm &norm, const GameState &state, float *observation,
+                          bool p1_perspective) {
   size_t index = 0;
   // coin pos
-  observation[index++] = F4(static_cast<int16_t>(state.coin_pos.x * CELL_SIZE)).to_float() * x_norm;
-  observation[index++] = F4(static_cast<int16_t>(state.coin_pos.y * CELL_SIZE)).to_float() * y_norm;
+  observation[index++] = F4(static_cast<int16_t>(state.coin_pos.x * CELL_SIZE)).to_float() * norm.x;
+  observation[index++] = F4(static_cast<int16_t>(state.coin_pos.y * CELL_SIZE)).to_float() * norm.y;
   // determine player state order based on who's observing (p1_perspective)
   const Player &first = p1_perspective ? state.p1 : state.p2;
   const Player &second = p1_perspective ? state.p2 : state.p1;
   // first player pos
-  observation[index++] = first.x.to_float() * x_norm;
-  observation[index++] = first.y.to_float() * y_norm;
+  observation[index++] = first.x.to_float() * norm.x;
+  observation[index++] = first.y.to_float() * norm.y;
   // first player vel
-  observation[index++] = first.x_vel.to_float() * x_vel_norm;
-  observation[index++] = first.y_vel.to_float() * y_vel_norm;
+  observation[index++] = first.x_vel.to_float() * norm.x_vel;
+  observation[index++] = first.y_vel.to_float() * norm.y_vel;
   // players dead
   observation[index++] = first.dead_timeout > 0 ? 1000.0f : 0.0f;
   observation[index++] = second.dead_timeout > 0 ? 1000.0f : 0.0f;
   // second player pos
-  observation[index++] = second.x.to_float() * x_norm;
-  observation[index++] = second.y.to_float() * y_norm;
+  observation[index++] = second.x.to_float() * norm.x;
+  observation[index++] = second.y.to_float() * norm.y;
   // second player vel
-  observation[index++] = second.x_vel.to_float() * x_vel_norm;
-  observation[index++] = second.y_vel.to_float() * y_vel_norm;
+  observation[index++] = second.x_vel.to_float() * norm.x_vel;
+  observation[index++] = second.y_vel.to_float() * norm.y_vel;
+}
+
+uint64_t hash_tile_map(const TileMap &map) {
+  // spawns are derived from the tiles, so they don't need hashing
+  uint64_t h = model::hash_combine(model::PARAM_HASH_SEED,
+                                   (static_cast<uint64_t>(map.width) << 32) |
+                                       static_cast<uint32_t>(map.height));
+  for (const auto &row : map.tiles) {
+    h = model::hash_bytes(h, row.data(), row.size());
+  }
+  return h;
 }
 
 int get_fitness(const GameState &state, bool p1_perspective) {
@@ -333,47 +100,31 @@ int get_fitness(const GameState &state, bool p1_perspective) {
   }
 }
 
-JnBGame::JnBGame(const std::string &map_filename, int frame_limit) : frame_limit(frame_limit) {
-  // load map
-  state.map.load_from_file(map_filename);
-
-  // load spritesheet
-  spritesheet = std::make_shared<std::vector<uint8_t>>();
-  uint32_t w, h;
-  auto error = lodepng::decode(*spritesheet, w, h, "tiles.png"); // TODO: move path to constexpr
-  if (error) {
-    std::cerr << "Error loading spritesheet: " << lodepng_error_text(error) << std::endl;
-    throw std::runtime_error("Failed to load spritesheet");
-  }
-  std::cout << "Loaded tiles.png" << std::endl;
-  std::cout << "Width: " << w << ", Height: " << h << std::endl;
+JnBGame::JnBGame(const std::string &map_filename, int frame_limit)
+    : map(assets::get_map(map_filename)), spritesheet(assets::get_spritesheet()),
+      frame_limit(frame_limit) {
+  const TileMap &tile_map = map->tile_map;
+
+  // the map never changes, so its pixels are drawn once and copied into every frame
+  auto map_pixels = std::make_shared<std::vector<uint32_t>>(tile_map.width * CELL_SIZE *
+                                                            tile_map.height * CELL_SIZE);
+  rendering::draw_map(*map_pixels, get_resolution(), spritesheet->pixels, tile_map.tiles,
+                      CELL_SIZE);
+  background = std::move(map_pixels);
 }
 
 void JnBGame::init(uint64_t seed) {
+  // a replay covers one episode
+  end_replay();
+  this->seed = seed;
+
   // clear some things
   state.p1 = {};
   state.p2 = {};
   state.age = 0;
 
-  // create rng from seed
-  state.rng = std::mt19937(seed);
-  // pick random position for coin
-  state.coin_pos = get_random_spawn_pos(state.rng, state.map);
-  // pick random positions for p1, p2
-  std::uniform_int_distribution<int> spawn_index_dist(0, state.map.spawns.size() - 1);
-  auto spawn_index = spawn_index_dist(state.rng);
-  auto spawn = state.map.spawns[spawn_index];
-  state.p1.x = F4(static_cast<int16_t>(spawn.x * CELL_SIZE));
-  state.p1.y = F4(static_cast<int16_t>(spawn.y * CELL_SIZE));
-  auto spawn_index_2 = spawn_index_dist(state.rng);
-  // ensure p2 doesn't spawn on p1
-  // TODO: extend to coin logic? or is this needlessly complicated for FPGA impl?
-  if (spawn_index_2 == spawn_index) {
-    spawn_index_2 = (spawn_index + 1) % state.map.spawns.size();
-  }
-  spawn = state.map.spawns[spawn_index_2];
-  state.p2.x = F4(static_cast<int16_t>(spawn.x * CELL_SIZE));
-  state.p2.y = F4(static_cast<int16_t>(spawn.y * CELL_SIZE));
+  spawn_initial(map->tile_map, state.rng, static_cast<uint32_t>(seed), state.coin_pos, state.p1,
+                state.p2);
 }
 
 void JnBGame::update(const std::vector<std::vector<float>> &actions) {
@@ -388,32 +139,10 @@ void JnBGame::update(const std::vector<std::vector<float>> &actions) {
   in2.right = actions[1][1] > 0;
   in2.jump = actions[1][2] > 0;
 
-  // update game state
-  // updating can happen in parallel in FPGA
-  auto p1_phases = make_player_phases(state.p1, state);
-  auto p2_phases = make_player_phases(state.p2, state);
-
-  // run each phase for each player
-  bool p1_coin_collected = false;
-  bool p2_coin_collected = false;
-  for (int i = 0; i < p1_phases.size(); ++i) {
-    // these can be concurrent on FPGA
-    p1_phases[i](state.p1, state.p2, in1, p1_coin_collected);
-    p2_phases[i](state.p2, state.p1, in2, p2_coin_collected);
-  }
-
-  // some other ideas: maybe the player could place a temporary ground tile
-  // beneath them, at the expense of one point (the coin reward would have to
-  // be much higher, so that its still worth placing ground tiles if it means
-  // increased likelyhood of getting the coin)
-
-  // if the coin was collected,
-  // pick a new location from the valid coin spawn locations randomly.
-  // this must happen on a new cycle, so the number of cycles on fpga is phases.size() + 1
-  if (p1_coin_collected || p2_coin_collected) {
-    state.coin_pos = get_random_spawn_pos(state.rng, state.map);
+  if (replay) {
+    replay->record(state, in1, in2);
   }
-  ++state.age;
+  step(*map, state, in1, in2);
 }
 
 void JnBGame::get_fitness(std::vector<int32_t> &fitness) {
@@ -429,51 +158,112 @@ bool JnBGame::is_done() {
 }
 
 void JnBGame::observe(std::vector<obs::Simple> &inputs) {
-  observe_state_simple(state, inputs[0], true);
-  observe_state_simple(state, inputs[1], false);
+  for (size_t i = 0; i < 2; ++i) {
+    inputs[i].resize(SIMPLE_INPUT_COUNT);
+    observe_state_simple(map->obs_norm, state, inputs[i].data(), i == 0);
+  }
+}
+
+void JnBGame::snapshot(std::vector<uint8_t> &buffer) const {
+  buffer.resize(sizeof(GameState));
+  std::memcpy(buffer.data(), &state, sizeof(GameState));
+}
+
+void JnBGame::restore(const std::vector<uint8_t> &buffer) {
+  assert(buffer.size() == sizeof(GameState));
+  std::memcpy(&state, buffer.data(), sizeof(GameState));
+}
+
+bool JnBGame::begin_replay(const std::string &filename) {
+  end_replay();
+  replay = std::make_shared<ReplayWriter>(map->hash, seed, state);
+  replay_filename = filename;
+  return true;
+}
+
+void JnBGame::end_replay() {
+  if (!replay) {
+    return;
+  }
+  replay->write(replay_filename);
+  replay = nullptr;
+  replay_filename.clear();
 }
 
 void JnBGame::render(std::vector<uint32_t> &pixels) {
-  // ensure pixels is the right size
-  pixels.resize(state.map.width * CELL_SIZE * state.map.height * CELL_SIZE);
+  rendering::RenderTarget target{};
+  render(pixels, target);
+}
 
-  // draw background, effectively clearing the screen
-  rendering::draw_map(pixels, get_resolution(), *spritesheet, state.map.tiles, CELL_SIZE);
+void JnBGame::render(std::vector<uint32_t> &pixels, rendering::RenderTarget &target) {
+  const TileMap &tile_map = map->tile_map;
+  const auto res = get_resolution();
+
+  if (target.source != background.get() || pixels.size() != background->size()) {
+    // nothing of ours in this buffer yet, start from a clean background
+    pixels.resize(background->size());
+    std::memcpy(pixels.data(), background->data(), background->size() * sizeof(uint32_t));
+  } else {
+    // only put the background back where this buffer's last frame drew over it
+    for (int i = 0; i < target.dirty_count; ++i) {
+      const rendering::Rect &r = target.dirty[i];
+      const int x_begin = std::max(r.x, 0);
+      const int x_end = std::min(r.x + r.w, res.first);
+      if (x_begin >= x_end) {
+        continue;
+      }
+      for (int y = std::max(r.y, 0); y < std::min(r.y + r.h, res.second); ++y) {
+        const size_t index = x_begin + static_cast<size_t>(y) * res.first;
+        std::memcpy(&pixels[index], &(*background)[index], (x_end - x_begin) * sizeof(uint32_t));
+      }
+    }
+  }
+  // regions drawn over the background: coin, two players and two score bars
+  target.source = background.get();
+  auto &dirty = target.dirty;
+  int &dirty_count = target.dirty_count;
+  dirty_count = 0;
 
   // draw coin
-  rendering::draw_tile(pixels, get_resolution(), *spritesheet, state.coin_pos.x,
-                       state.map.height - state.coin_pos.y - 1, CELL_SIZE,
+  const int coin_x = state.coin_pos.x;
+  const int coin_y = tile_map.height - state.coin_pos.y - 1;
+  rendering::draw_tile(pixels, res, spritesheet->pixels, coin_x, coin_y, CELL_SIZE,
                        static_cast<int>(Tile::COIN) - 1);
+  dirty[dirty_count++] = {coin_x * CELL_SIZE, coin_y * CELL_SIZE, CELL_SIZE, CELL_SIZE};
 
   // draw players
+  auto draw_player = [&](const Player &p, uint32_t color) {
+    if (p.dead_timeout != 0) {
+      return;
+    }
+    const int x = p.x.to_integer_floor();
+    const int y = tile_map.height * CELL_SIZE - p.y.to_integer_floor() - PLAYER_HEIGHT;
+    rendering::draw_rect(pixels, res, x, y, PLAYER_WIDTH, PLAYER_HEIGHT, color);
+    dirty[dirty_count++] = {x, y, PLAYER_WIDTH, PLAYER_HEIGHT};
+  };
   // p1 is light red
   int32_t p1_col = rendering::make_color(255, 80, 80, 255);
-  if (state.p1.dead_timeout == 0)
-    rendering::draw_rect(pixels, get_resolution(), state.p1.x.to_integer_floor(),
-                         state.map.height * CELL_SIZE - state.p1.y.to_integer_floor() -
-                             PLAYER_HEIGHT,
-                         PLAYER_WIDTH, PLAYER_HEIGHT, p1_col);
-
+  draw_player(state.p1, p1_col);
   // p2 is light blue
   int32_t p2_col = rendering::make_color(80, 80, 255, 255);
-  if (state.p2.dead_timeout == 0)
-    rendering::draw_rect(pixels, get_resolution(), state.p2.x.to_integer_floor(),
-                         state.map.height * CELL_SIZE - state.p2.y.to_integer_floor() -
-                             PLAYER_HEIGHT,
-                         PLAYER_WIDTH, PLAYER_HEIGHT, p2_col);
-
-  // draw score
-  for (int i = 0; i < std::min(state.p1.score, state.map.width * CELL_SIZE); ++i) {
+  draw_player(state.p2, p2_col);
+
+  // draw score, as bars along the top two rows
+  const int p1_bar = std::min(state.p1.score, tile_map.width * CELL_SIZE);
+  for (int i = 0; i < p1_bar; ++i) {
     pixels[i] = p1_col;
   }
-  for (int i = 0; i < std::min(state.p2.score, state.map.width * CELL_SIZE); ++i) {
-    // pixels[(((state.map.width) * CELL_SIZE) * 2 - i - 1)] = p2_col;
-    pixels[i + state.map.width * CELL_SIZE] = p2_col;
+  dirty[dirty_count++] = {0, 0, p1_bar, 1};
+  const int p2_bar = std::min(state.p2.score, tile_map.width * CELL_SIZE);
+  for (int i = 0; i < p2_bar; ++i) {
+    // pixels[(((tile_map.width) * CELL_SIZE) * 2 - i - 1)] = p2_col;
+    pixels[i + tile_map.width * CELL_SIZE] = p2_col;
   }
+  dirty[dirty_count++] = {0, 1, p2_bar, 1};
 }
 
 std::pair<int, int> JnBGame::get_resolution() {
-  return {state.map.width * CELL_SIZE, state.map.height * CELL_SIZE};
+  return {map->tile_map.width * CELL_SIZE, map->tile_map.height * CELL_SIZE};
 }
 
 } // namespace jnb
@@ -2,15 +2,22 @@
 
 #include <array>
 #include <cstdint>
-#include <random>
+#include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "collision_map.h"
 #include "fixed_point.h"
 #include "parse_map.h"
 #include "game.h"
 #include "observation_types.h"
+#include "xormix32.h"
+
+namespace assets {
+struct Image;
+} // namespace assets
 
 namespace jnb {
 
@@ -61,14 +68,52 @@ struct Player {
   bool queue_dead{false}; // this is NOT needed on FPGA, just a hack for CPU version
 };
 
+// same rng as game.vhd: xormix32 seeded with seed_x = seed and seed_y = 0,
+// one stream for each of the three spawn tiles
+using GameRng = Xormix32<3>;
+constexpr int RNG_STREAM_P1 = 0;
+constexpr int RNG_STREAM_P2 = 1;
+constexpr int RNG_STREAM_COIN = 2;
+// INIT_CYCLES in game.vhd
+constexpr int RNG_INIT_CYCLES = 7;
+
+uint64_t hash_tile_map(const TileMap &map);
+
+// scale factors observe_state_simple applies. they only depend on the map, so they are computed
+// once per map instead of on every observation.
+struct ObsNorm {
+  float x{1.0f};     // 1 / map width in pixels
+  float y{1.0f};     // 1 / map height in pixels
+  float x_vel{1.0f}; // 1 / MOVE_MAX_VEL
+  float y_vel{1.0f}; // 1 / -FALL_MAX_VEL
+
+  ObsNorm() = default;
+  explicit ObsNorm(const TileMap &map);
+};
+
+// everything about the map that stays fixed while games are played on it.
+// games share one read-only instance instead of each holding a copy of the tile vectors.
+struct MapData {
+  TileMap tile_map{};
+  CollisionMap collision{}; // compiled from tile_map, used by the physics
+  uint64_t hash{0};         // content hash of tile_map, identifies the map in replays
+  ObsNorm obs_norm{};
+
+  MapData() = default;
+  explicit MapData(const TileMap &tile_map)
+      : tile_map(tile_map), collision(tile_map), hash(hash_tile_map(tile_map)),
+        obs_norm(tile_map) {}
+};
+
+// the mutable part of a game. plain data, so snapshots are straight copies.
 struct GameState {
-  TileMap map{};
   Player p1{};
   Player p2{};
   TilePos coin_pos{0, 0};
-  std::mt19937 rng{0};
+  GameRng rng{};
   uint32_t age{0};
 };
+static_assert(std::is_trivially_copyable_v<GameState>);
 
 struct PlayerInput {
   bool left{false};
@@ -76,12 +121,31 @@ struct PlayerInput {
   bool jump{false};
 };
 
+// packed input bits, same layout as the PLAYER_INPUT_MSG byte sent to the PL
+constexpr uint8_t INPUT_LEFT = 0x01;
+constexpr uint8_t INPUT_RIGHT = 0x02;
+constexpr uint8_t INPUT_JUMP = 0x04;
+
+constexpr uint8_t pack_input(const PlayerInput &input) {
+  return (input.left ? INPUT_LEFT : 0) | (input.right ? INPUT_RIGHT : 0) |
+         (input.jump ? INPUT_JUMP : 0);
+}
+
+constexpr PlayerInput unpack_input(uint8_t bits) {
+  return {(bits & INPUT_LEFT) != 0, (bits & INPUT_RIGHT) != 0, (bits & INPUT_JUMP) != 0};
+}
+
 void observe_state_simple(const GameState &state, std::vector<F4> &observation,
                           bool p1_perspective);
-void observe_state_simple(const GameState &state, std::vector<float> &observation,
+void observe_state_simple(const TileMap &map, const GameState &state,
+                          std::vector<float> &observation, bool p1_perspective);
+// writes SIMPLE_INPUT_COUNT floats to observation
+void observe_state_simple(const ObsNorm &norm, const GameState &state, float *observation,
                           bool p1_perspective);
 int get_fitness(const GameState &state, bool p1_perspective);
-// void observe_state_screen(const GameState &state, std::vector<uint8_t> &observation);
+// image observations are rendered by ImageObserver in jnb_obs_image.h
+
+class ReplayWriter;
 
 class JnBGame : public Game<obs::Simple> {
 public:
@@ -111,26 +175,53 @@ public:
     return 2;
   }
 
+  int get_frame_limit() override {
+    return frame_limit;
+  }
+
   std::string get_name() override {
     return "JnB";
   }
 
   void render(std::vector<uint32_t> &pixels) override;
+  // only the areas target's last frame drew over are redrawn
+  void render(std::vector<uint32_t> &pixels, rendering::RenderTarget &target) override;
   std::pair<int, int> get_resolution() override;
   std::unique_ptr<Game<obs::Simple>> clone() const override {
+    // the map and spritesheet are shared, only the state is copied
     auto new_game = std::make_unique<JnBGame>(*this);
     new_game->state = state;
+    // a recording belongs to this game only
+    new_game->replay = nullptr;
+    new_game->replay_filename.clear();
     return new_game;
   }
 
+  void snapshot(std::vector<uint8_t> &buffer) const override;
+  void restore(const std::vector<uint8_t> &buffer) override;
+
+  bool begin_replay(const std::string &filename) override;
+  void end_replay() override;
+
+  // shared with clones, and can be handed to JnBBatch
+  const std::shared_ptr<const MapData> &get_map() const {
+    return map;
+  }
+
   // game state is public for PL interop
   GameState state{};
 
 private:
   // resources
-  std::shared_ptr<std::vector<uint8_t>> spritesheet{nullptr};
+  std::shared_ptr<const MapData> map{nullptr};
+  std::shared_ptr<const assets::Image> spritesheet{nullptr};
+  std::shared_ptr<const std::vector<uint32_t>> background{nullptr}; // the map, drawn once
 
   int frame_limit;
+  uint64_t seed{0}; // from the last init, recorded in replays
+
+  std::shared_ptr<ReplayWriter> replay{nullptr};
+  std::string replay_filename{};
 };
 
 } // namespace jnb
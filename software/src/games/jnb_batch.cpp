@@ -0,0 +1,222 @@
+#include "jnb_batch.h"
+
+#include <cassert>
+#include <utility>
+
+#include "jnb_step.h"
+
+namespace jnb {
+
+void ObservationBatch::resize(size_t game_count, size_t player_count) {
+  this->game_count = game_count;
+  this->player_count = player_count;
+  values.resize(game_count * player_count * SIMPLE_INPUT_COUNT);
+}
+
+void JnBBatch::PlayerArrays::resize(size_t size) {
+  x.resize(size);
+  y.resize(size);
+  x_vel.resize(size);
+  y_vel.resize(size);
+  score.resize(size);
+  dead_timeout.resize(size);
+  queue_dead.resize(size);
+}
+
+void JnBBatch::PlayerArrays::load(size_t game, Player &p) const {
+  p.x = F4::from_raw(x[game]);
+  p.y = F4::from_raw(y[game]);
+  p.x_vel = F4::from_raw(x_vel[game]);
+  p.y_vel = F4::from_raw(y_vel[game]);
+  p.score = score[game];
+  p.dead_timeout = dead_timeout[game];
+  p.queue_dead = queue_dead[game] != 0;
+}
+
+void JnBBatch::PlayerArrays::store(size_t game, const Player &p) {
+  x[game] = p.x.raw_value();
+  y[game] = p.y.raw_value();
+  x_vel[game] = p.x_vel.raw_value();
+  y_vel[game] = p.y_vel.raw_value();
+  score[game] = p.score;
+  dead_timeout[game] = p.dead_timeout;
+  queue_dead[game] = p.queue_dead;
+}
+
+JnBBatch::JnBBatch(std::shared_ptr<const MapData> map, size_t game_count, int frame_limit)
+    : map(std::move(map)), game_count(game_count),
+      frame_limit(frame_limit > 0 ? static_cast<uint32_t>(frame_limit) : 0) {
+  for (auto &p : players) {
+    p.resize(game_count);
+  }
+  coin_x.resize(game_count);
+  coin_y.resize(game_count);
+  age.resize(game_count);
+  rng.resize(game_count);
+  episode.resize(game_count, NO_EPISODE);
+  active.resize(game_count, 0);
+  coin_collected.resize(game_count, 0);
+}
+
+void JnBBatch::reset(const std::vector<uint64_t> &seeds) {
+  this->seeds = seeds;
+  episode_fitness.assign(seeds.size(), 0);
+  next_seed = 0;
+  active_count = 0;
+  for (size_t i = 0; i < game_count; ++i) {
+    start_episode(i);
+  }
+}
+
+void JnBBatch::start_episode(size_t game) {
+  if (next_seed >= seeds.size()) {
+    // nothing left to play
+    if (episode[game] != NO_EPISODE) {
+      --active_count;
+    }
+    episode[game] = NO_EPISODE;
+    active[game] = 0;
+    return;
+  }
+
+  if (episode[game] == NO_EPISODE) {
+    ++active_count;
+  }
+  episode[game] = next_seed;
+  active[game] = 1;
+
+  // same initialization as JnBGame::init
+  Player p1{}, p2{};
+  TilePos coin_pos{0, 0};
+  spawn_initial(map->tile_map, rng[game], static_cast<uint32_t>(seeds[next_seed]), coin_pos, p1, p2);
+  players[0].store(game, p1);
+  players[1].store(game, p2);
+  coin_x[game] = coin_pos.x;
+  coin_y[game] = coin_pos.y;
+  age[game] = 0;
+
+  ++next_seed;
+}
+
+void JnBBatch::step(std::span<const uint8_t> actions) {
+  assert(actions.size() == game_count * get_player_count());
+  step_players(actions);
+  end_frame();
+}
+
+void JnBBatch::step_players(std::span<const uint8_t> actions) {
+  simd::Lanes lanes;
+  lanes.size = game_count;
+  for (int p = 0; p < 2; ++p) {
+    lanes.x[p] = players[p].x.data();
+    lanes.y[p] = players[p].y.data();
+    lanes.x_vel[p] = players[p].x_vel.data();
+    lanes.y_vel[p] = players[p].y_vel.data();
+    lanes.score[p] = players[p].score.data();
+    lanes.dead_timeout[p] = players[p].dead_timeout.data();
+    lanes.queue_dead[p] = players[p].queue_dead.data();
+  }
+  lanes.coin_x = coin_x.data();
+  lanes.coin_y = coin_y.data();
+  lanes.active = active.data();
+  lanes.actions = actions.data();
+
+  simd::phase_1(isa, map->collision, lanes);
+
+  // respawns read the per-game rng and the spawn list, so they stay scalar.
+  // the rng steps once per frame whether or not anything spawns, same as update_players.
+  for (size_t i = 0; i < game_count; ++i) {
+    if (!active[i]) {
+      continue;
+    }
+    rng[i].advance();
+    for (int pi = 0; pi < 2; ++pi) {
+      auto &p = players[pi];
+      if (p.dead_timeout[i] == 1) {
+        auto tile_pos = sample_spawn(map->tile_map, rng[i].result(RNG_STREAM_P1 + pi));
+        p.x[i] = F4(static_cast<int16_t>(tile_pos.x * CELL_SIZE)).raw_value();
+        p.y[i] = F4(static_cast<int16_t>(tile_pos.y * CELL_SIZE)).raw_value();
+        p.x_vel[i] = 0;
+        p.y_vel[i] = 0;
+      }
+    }
+  }
+
+  simd::phase_2(isa, map->collision, lanes, coin_collected.data());
+
+  // coin respawn, also drawn from the per-game rng
+  for (size_t i = 0; i < game_count; ++i) {
+    if (active[i] && coin_collected[i]) {
+      auto tile_pos = sample_spawn(map->tile_map, rng[i].result(RNG_STREAM_COIN));
+      coin_x[i] = tile_pos.x;
+      coin_y[i] = tile_pos.y;
+    }
+  }
+}
+
+void JnBBatch::end_frame() {
+  for (size_t i = 0; i < game_count; ++i) {
+    if (!active[i]) {
+      continue;
+    }
+    ++age[i];
+
+    // record the result and move on to the next seed
+    if (frame_limit != 0 && age[i] >= frame_limit) {
+      episode_fitness[episode[i]] = players[0].score[i] - players[1].score[i];
+      start_episode(i);
+    }
+  }
+}
+
+void JnBBatch::observe(ObservationBatch &out) const {
+  static_assert(SIMPLE_INPUT_COUNT == 12, "observe writes the observe_state_simple layout");
+  out.resize(game_count, 2);
+  const ObsNorm &norm = map->obs_norm;
+  const size_t stride = 2 * SIMPLE_INPUT_COUNT;
+  // raw F4 to float is an exact division, so these match F4::to_float() * norm bit for bit
+  constexpr float raw_scale = 1.0f / F4::ONE;
+
+  for (int p = 0; p < 2; ++p) {
+    const PlayerArrays &first = players[p];
+    const PlayerArrays &second = players[1 - p];
+    float *base = out.data() + p * SIMPLE_INPUT_COUNT;
+
+    // one feature at a time across games, same order as observe_state_simple
+#pragma omp simd
+    for (size_t i = 0; i < game_count; ++i) {
+      float *o = base + i * stride;
+      o[0] = static_cast<float>(coin_x[i] * CELL_SIZE) * norm.x;
+      o[1] = static_cast<float>(coin_y[i] * CELL_SIZE) * norm.y;
+      o[2] = static_cast<float>(first.x[i]) * raw_scale * norm.x;
+      o[3] = static_cast<float>(first.y[i]) * raw_scale * norm.y;
+      o[4] = static_cast<float>(first.x_vel[i]) * raw_scale * norm.x_vel;
+      o[5] = static_cast<float>(first.y_vel[i]) * raw_scale * norm.y_vel;
+      o[6] = first.dead_timeout[i] > 0 ? 1000.0f : 0.0f;
+      o[7] = second.dead_timeout[i] > 0 ? 1000.0f : 0.0f;
+      o[8] = static_cast<float>(second.x[i]) * raw_scale * norm.x;
+      o[9] = static_cast<float>(second.y[i]) * raw_scale * norm.y;
+      o[10] = static_cast<float>(second.x_vel[i]) * raw_scale * norm.x_vel;
+      o[11] = static_cast<float>(second.y_vel[i]) * raw_scale * norm.y_vel;
+    }
+  }
+}
+
+void JnBBatch::load(size_t game, GameState &state) const {
+  players[0].load(game, state.p1);
+  players[1].load(game, state.p2);
+  state.coin_pos = {coin_x[game], coin_y[game]};
+  state.rng = rng[game];
+  state.age = age[game];
+}
+
+void JnBBatch::store(size_t game, const GameState &state) {
+  players[0].store(game, state.p1);
+  players[1].store(game, state.p2);
+  coin_x[game] = state.coin_pos.x;
+  coin_y[game] = state.coin_pos.y;
+  rng[game] = state.rng;
+  age[game] = state.age;
+}
+
+} // namespace jnb
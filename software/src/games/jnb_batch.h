@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "aligned_allocator.h"
+#include "jnb.h"
+#include "jnb_simd.h"
+#include "parse_map.h"
+
+namespace jnb {
+
+// simple observations of every player of every game in one contiguous buffer, laid out
+// [game][player][SIMPLE_INPUT_COUNT] and aligned to a cache line. each player's observation is a
+// plain slice, so models can read it in place through Model::forward_flat.
+class ObservationBatch {
+public:
+  static constexpr size_t ALIGNMENT = 64; // bytes
+
+  void resize(size_t game_count, size_t player_count);
+
+  size_t get_game_count() const {
+    return game_count;
+  }
+
+  size_t get_player_count() const {
+    return player_count;
+  }
+
+  float *data() {
+    return values.data();
+  }
+
+  const float *data() const {
+    return values.data();
+  }
+
+  std::span<const float> get(size_t game, size_t player) const {
+    return {data() + (game * player_count + player) * SIMPLE_INPUT_COUNT, SIMPLE_INPUT_COUNT};
+  }
+
+private:
+  size_t game_count{0};
+  size_t player_count{0};
+  std::vector<float, AlignedAllocator<float, ALIGNMENT>> values{};
+};
+
+// a batch of independent JnB games that all share one map and are stepped together.
+// state is stored as structure-of-arrays (one contiguous array per field, indexed by game)
+// so that a frame of every game can be processed with contiguous loads.
+class JnBBatch {
+public:
+  // marks a game that has no episode to play
+  static constexpr size_t NO_EPISODE = SIZE_MAX;
+
+  // per-player state, each array has one entry per game
+  struct PlayerArrays {
+    std::vector<int16_t> x{};     // raw F4
+    std::vector<int16_t> y{};     // raw F4
+    std::vector<int16_t> x_vel{}; // raw F4
+    std::vector<int16_t> y_vel{}; // raw F4
+    std::vector<int32_t> score{};
+    std::vector<int32_t> dead_timeout{};
+    std::vector<uint8_t> queue_dead{};
+
+    void resize(size_t size);
+    void load(size_t game, Player &p) const;
+    void store(size_t game, const Player &p);
+  };
+
+  // negative frame_limit means unlimited, in which case games never auto-reset
+  JnBBatch(std::shared_ptr<const MapData> map, size_t game_count, int frame_limit = 400);
+
+  // queue up one episode per seed. games pick up seeds in order, and when a game finishes
+  // its episode it is re-initialized with the next unplayed seed. once the seeds run out,
+  // finished games go idle.
+  void reset(const std::vector<uint64_t> &seeds);
+
+  // step every active game by one frame.
+  // actions holds packed PlayerInput bits (see pack_input), indexed [player * size() + game].
+  void step(std::span<const uint8_t> actions);
+
+  // fill out with the simple observation of both players of every game, the same values
+  // observe_state_simple gives. idle games are observed too, their slices are just unused.
+  void observe(ObservationBatch &out) const;
+
+  // which physics kernel step() uses. defaults to the best one the cpu supports.
+  // SCALAR is the baseline build of the lane kernels, every kernel gives the same results as
+  // stepping each game through update_players.
+  void set_isa(simd::Isa isa) {
+    this->isa = isa;
+  }
+
+  simd::Isa get_isa() const {
+    return isa;
+  }
+
+  // true when every queued episode has finished
+  bool is_done() const {
+    return active_count == 0;
+  }
+
+  size_t size() const {
+    return game_count;
+  }
+
+  size_t get_player_count() const {
+    return 2;
+  }
+
+  // index into the seed list of the episode game is playing, or NO_EPISODE if idle
+  size_t get_episode(size_t game) const {
+    return episode[game];
+  }
+
+  // final p1 fitness of each finished episode, indexed like the seed list
+  const std::vector<int32_t> &get_episode_fitness() const {
+    return episode_fitness;
+  }
+
+  const MapData &get_map() const {
+    return *map;
+  }
+
+  // copy one game in or out of the batch, e.g. for rendering or comparison against JnBGame.
+  void load(size_t game, GameState &state) const;
+  void store(size_t game, const GameState &state);
+
+  // structure-of-arrays state, public for the same reason as JnBGame::state
+  PlayerArrays players[2]{};
+  std::vector<uint8_t> coin_x{};
+  std::vector<uint8_t> coin_y{};
+  std::vector<uint32_t> age{};
+
+private:
+  void start_episode(size_t game);
+  void step_players(std::span<const uint8_t> actions);
+  void end_frame();
+
+  std::shared_ptr<const MapData> map;
+  size_t game_count;
+  uint32_t frame_limit; // 0 if unlimited
+
+  simd::Isa isa{simd::detect_isa()};
+  std::vector<uint8_t> active{};
+  std::vector<uint8_t> coin_collected{};
+
+  std::vector<GameRng> rng{};
+  std::vector<size_t> episode{};
+  std::vector<uint64_t> seeds{};
+  std::vector<int32_t> episode_fitness{};
+  size_t next_seed{0};
+  size_t active_count{0};
+};
+
+} // namespace jnb
@@ -0,0 +1,92 @@
+#include "jnb_obs_image.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace jnb {
+
+namespace {
+
+// rounds toward negative infinity, players can be partly off the map
+int floor_div(int a, int b) {
+  return a / b - (a % b != 0 && a < 0);
+}
+
+} // namespace
+
+ImageObserver::ImageObserver(const TileMap &map, int cell_size)
+    : cell_size(cell_size), width(map.width * CELL_SIZE / cell_size),
+      height(map.height * CELL_SIZE / cell_size) {
+  assert(cell_size > 0 && CELL_SIZE % cell_size == 0);
+  const int per_tile = CELL_SIZE / cell_size;
+
+  // tiles are stored top row first, same as the image
+  background.resize(static_cast<size_t>(width) * height);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      background[y * width + x] = map.tiles[y / per_tile][x / per_tile];
+    }
+  }
+}
+
+obs::Image ImageObserver::build_observation() const {
+  return obs::Image(height, std::vector<uint8_t>(width));
+}
+
+void ImageObserver::observe(const GameState &state, bool p1_perspective,
+                            obs::Image &image) const {
+  if (image.size() != static_cast<size_t>(height)) {
+    image = build_observation();
+  }
+  for (int y = 0; y < height; ++y) {
+    std::memcpy(image[y].data(), &background[y * width], width);
+  }
+
+  stamp(image, state.coin_pos.x * CELL_SIZE, state.coin_pos.y * CELL_SIZE, CELL_SIZE, CELL_SIZE,
+        IMAGE_COIN);
+
+  // the observer goes last so it is never hidden by the opponent
+  const Player &self = p1_perspective ? state.p1 : state.p2;
+  const Player &other = p1_perspective ? state.p2 : state.p1;
+  if (other.dead_timeout == 0) {
+    stamp(image, other.x.to_integer_floor(), other.y.to_integer_floor(), PLAYER_WIDTH,
+          PLAYER_HEIGHT, IMAGE_OTHER);
+  }
+  if (self.dead_timeout == 0) {
+    stamp(image, self.x.to_integer_floor(), self.y.to_integer_floor(), PLAYER_WIDTH,
+          PLAYER_HEIGHT, IMAGE_SELF);
+  }
+}
+
+void ImageObserver::stamp(obs::Image &image, int x, int y, int w, int h, uint8_t id) const {
+  // cell range covering the pixels, with the y axis flipped to image rows
+  const int map_height = height * cell_size;
+  const int x_begin = std::max(floor_div(x, cell_size), 0);
+  const int x_end = std::min(floor_div(x + w - 1, cell_size) + 1, width);
+  const int row_begin = std::max(floor_div(map_height - (y + h), cell_size), 0);
+  const int row_end = std::min(floor_div(map_height - y - 1, cell_size) + 1, height);
+  for (int row = row_begin; row < row_end; ++row) {
+    for (int col = x_begin; col < x_end; ++col) {
+      image[row][col] = id;
+    }
+  }
+}
+
+JnBImageGame::JnBImageGame(const std::string &map_filename, int frame_limit, int cell_size)
+    : game(std::make_unique<JnBGame>(map_filename, frame_limit)) {
+  observer = std::make_shared<const ImageObserver>(game->get_map()->tile_map, cell_size);
+}
+
+void JnBImageGame::observe(std::vector<obs::Image> &inputs) {
+  observer->observe(game->state, true, inputs[0]);
+  observer->observe(game->state, false, inputs[1]);
+}
+
+std::unique_ptr<Game<obs::Image>> JnBImageGame::clone() const {
+  auto game_clone = game->clone();
+  std::unique_ptr<JnBGame> jnb_clone(static_cast<JnBGame *>(game_clone.release()));
+  return std::unique_ptr<Game<obs::Image>>(new JnBImageGame(std::move(jnb_clone), observer));
+}
+
+} // namespace jnb
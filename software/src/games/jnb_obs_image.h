@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+#include "jnb.h"
+#include "observation_types.h"
+
+namespace jnb {
+
+// class ids in image observations. map cells keep their Tile value, the rest come after COIN.
+constexpr uint8_t IMAGE_COIN = Tile::COIN;
+constexpr uint8_t IMAGE_SELF = Tile::COIN + 1;  // the observing player
+constexpr uint8_t IMAGE_OTHER = Tile::COIN + 2; // their opponent
+
+// renders obs::Image observations: one class id per cell, rows top to bottom like render().
+// the map is rasterized once, so each observation is a copy of that background with the coin
+// and the living players stamped on top. no sprites or colors are involved.
+class ImageObserver {
+public:
+  // cell_size is the side of the square of map pixels that becomes one value. 1 gives full
+  // resolution, CELL_SIZE gives one value per tile. must divide CELL_SIZE.
+  explicit ImageObserver(const TileMap &map, int cell_size = 1);
+
+  // (width, height) in cells
+  std::pair<int, int> get_resolution() const {
+    return {width, height};
+  }
+
+  // an image of the right size, to be reused across observe calls
+  obs::Image build_observation() const;
+
+  void observe(const GameState &state, bool p1_perspective, obs::Image &image) const;
+
+private:
+  // fill the cells covering a rectangle of map pixels, with x and y the bottom left in y-up
+  // pixel coordinates. clipped to the image.
+  void stamp(obs::Image &image, int x, int y, int w, int h, uint8_t id) const;
+
+  int cell_size;
+  int width;
+  int height;
+  std::vector<uint8_t> background{}; // width * height, same layout as the image
+};
+
+// JnB with image observations. wraps a JnBGame for everything but observe.
+class JnBImageGame : public Game<obs::Image> {
+public:
+  // negative frame_limit means unlimited. see ImageObserver for cell_size.
+  JnBImageGame(const std::string &map_filename, int frame_limit = 400, int cell_size = CELL_SIZE);
+
+  void init(uint64_t seed) override {
+    game->init(seed);
+  }
+  void update(const std::vector<std::vector<float>> &actions) override {
+    game->update(actions);
+  }
+  void get_fitness(std::vector<int32_t> &fitness) override {
+    game->get_fitness(fitness);
+  }
+  bool is_done() override {
+    return game->is_done();
+  }
+  void observe(std::vector<obs::Image> &inputs) override;
+
+  std::vector<obs::Image> build_observation() override {
+    return std::vector<obs::Image>(get_player_count(), observer->build_observation());
+  }
+
+  size_t get_action_count() override {
+    return game->get_action_count();
+  }
+  size_t get_player_count() override {
+    return game->get_player_count();
+  }
+  int get_frame_limit() override {
+    return game->get_frame_limit();
+  }
+  std::string get_name() override {
+    return "JnBImage";
+  }
+
+  void render(std::vector<uint32_t> &pixels) override {
+    game->render(pixels);
+  }
+  void render(std::vector<uint32_t> &pixels, rendering::RenderTarget &target) override {
+    game->render(pixels, target);
+  }
+  std::pair<int, int> get_resolution() override {
+    return game->get_resolution();
+  }
+  std::unique_ptr<Game<obs::Image>> clone() const override;
+
+  void snapshot(std::vector<uint8_t> &buffer) const override {
+    game->snapshot(buffer);
+  }
+  void restore(const std::vector<uint8_t> &buffer) override {
+    game->restore(buffer);
+  }
+
+  bool begin_replay(const std::string &filename) override {
+    return game->begin_replay(filename);
+  }
+  void end_replay() override {
+    game->end_replay();
+  }
+
+  JnBGame &get_game() {
+    return *game;
+  }
+
+private:
+  JnBImageGame(std::unique_ptr<JnBGame> game, std::shared_ptr<const ImageObserver> observer)
+      : game(std::move(game)), observer(std::move(observer)) {}
+
+  std::unique_ptr<JnBGame> game;
+  std::shared_ptr<const ImageObserver> observer; // shared with clones, like the map
+};
+
+} // namespace jnb
@@ -6,7 +6,6 @@
 #include <thread>
 #include <fstream>
 
-#include "lodepng.h"
 #include "imgui.h"
 #include "serial_cpp/serial.h"
 
@@ -279,16 +278,6 @@ void run_on_pl(const std::string &map_filename) {
 
   PlayerInput input;
 
-  std::vector<uint8_t> spritesheet;
-  uint32_t w, h;
-  auto error = lodepng::decode(spritesheet, w, h, "tiles.png"); // TODO: move path to constexpr
-  if (error) {
-    std::cerr << "Error loading spritesheet: " << lodepng_error_text(error) << std::endl;
-    throw std::runtime_error("Failed to load spritesheet");
-  }
-  std::cout << "Loaded tiles.png" << std::endl;
-  std::cout << "Width: " << w << ", Height: " << h << std::endl;
-
   // TODO: these don't need to be shared ptrs
   auto ga_config = std::make_shared<GAConfig>();
   auto eval_config = std::make_shared<EvalConfig>();
@@ -382,8 +371,8 @@ void run_on_pl(const std::string &map_filename) {
     }
 
     if (program_state != WAIT_FOR_UART_CONN) {
-      imgui_state_control(program_state, set_uart, game.state.map, *ga_config, *eval_config,
-                          bram_to_save);
+      imgui_state_control(program_state, set_uart, game.get_map()->tile_map, *ga_config,
+                          *eval_config, bram_to_save);
     }
 
     // state transitions
@@ -514,8 +503,8 @@ void run_on_pl(const std::string &map_filename) {
   std::cout << "Launching game..." << std::endl;
   window.run(
       update_lambda,
-      [&game](std::vector<uint32_t> &pixels) {
-        game.render(pixels);
+      [&game](std::vector<uint32_t> &pixels, rendering::RenderTarget &target) {
+        game.render(pixels, target);
         return game.get_resolution();
       },
       handle_input_lambda, combined_imgui_lambda);
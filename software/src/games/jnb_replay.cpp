@@ -0,0 +1,174 @@
+#include "jnb_replay.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "jnb_step.h"
+
+namespace jnb {
+
+namespace {
+
+size_t input_bytes(uint32_t frame_count) {
+  return (static_cast<size_t>(frame_count) * REPLAY_BITS_PER_FRAME + 7) / 8;
+}
+
+} // namespace
+
+ReplayWriter::ReplayWriter(uint64_t map_hash, uint64_t seed, const GameState &start,
+                           uint32_t keyframe_interval) {
+  header.map_hash = map_hash;
+  header.seed = seed;
+  header.keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 1;
+  keyframes.push_back(start);
+}
+
+void ReplayWriter::record(const GameState &state, const PlayerInput &p1_input,
+                          const PlayerInput &p2_input) {
+  const uint32_t frame = header.frame_count;
+  if (frame > 0 && frame % header.keyframe_interval == 0) {
+    keyframes.push_back(state);
+  }
+
+  // 6 bits starting at bit 6 * frame, which can straddle a byte boundary
+  const uint32_t bits = pack_input(p1_input) | (pack_input(p2_input) << 3);
+  const size_t bit = static_cast<size_t>(frame) * REPLAY_BITS_PER_FRAME;
+  inputs.resize(input_bytes(frame + 1), 0);
+  inputs[bit / 8] |= static_cast<uint8_t>(bits << (bit % 8));
+  if (bit % 8 > 8 - REPLAY_BITS_PER_FRAME) {
+    inputs[bit / 8 + 1] |= static_cast<uint8_t>(bits >> (8 - bit % 8));
+  }
+
+  ++header.frame_count;
+}
+
+bool ReplayWriter::write(const std::string &filename) const {
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open replay file: " << filename << std::endl;
+    return false;
+  }
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(keyframes.data()),
+             keyframes.size() * sizeof(GameState));
+  file.write(reinterpret_cast<const char *>(inputs.data()), inputs.size());
+  if (!file) {
+    std::cerr << "Failed to write replay file: " << filename << std::endl;
+    return false;
+  }
+  return true;
+}
+
+ReplayReader::~ReplayReader() {
+  close();
+}
+
+bool ReplayReader::open(const std::string &filename) {
+  close();
+
+#ifdef _WIN32
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open replay file: " << filename << std::endl;
+    return false;
+  }
+  file_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  data = file_data.data();
+  size = file_data.size();
+#else
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Failed to open replay file: " << filename << std::endl;
+    return false;
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    std::cerr << "Failed to read replay file: " << filename << std::endl;
+    ::close(fd);
+    return false;
+  }
+  void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping stays valid after the descriptor is closed
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Failed to map replay file: " << filename << std::endl;
+    return false;
+  }
+  data = static_cast<const uint8_t *>(mapping);
+  size = st.st_size;
+#endif
+
+  if (size < sizeof(ReplayHeader)) {
+    std::cerr << "Not a replay file: " << filename << std::endl;
+    close();
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != REPLAY_MAGIC || header.version != REPLAY_VERSION ||
+      header.state_size != sizeof(GameState) || header.keyframe_interval == 0) {
+    std::cerr << "Unsupported replay file: " << filename << std::endl;
+    close();
+    return false;
+  }
+  const size_t keyframe_size = replay_keyframe_count(header) * sizeof(GameState);
+  if (size < sizeof(ReplayHeader) + keyframe_size + input_bytes(header.frame_count)) {
+    std::cerr << "Truncated replay file: " << filename << std::endl;
+    close();
+    return false;
+  }
+  keyframes = data + sizeof(ReplayHeader);
+  inputs = keyframes + keyframe_size;
+  return true;
+}
+
+void ReplayReader::close() {
+#ifdef _WIN32
+  file_data.clear();
+#else
+  if (data) {
+    munmap(const_cast<uint8_t *>(data), size);
+  }
+#endif
+  data = nullptr;
+  size = 0;
+  header = {};
+  keyframes = nullptr;
+  inputs = nullptr;
+}
+
+std::pair<PlayerInput, PlayerInput> ReplayReader::get_inputs(uint32_t frame) const {
+  const size_t bit = static_cast<size_t>(frame) * REPLAY_BITS_PER_FRAME;
+  uint32_t bits = inputs[bit / 8] >> (bit % 8);
+  if (bit % 8 > 8 - REPLAY_BITS_PER_FRAME) {
+    bits |= inputs[bit / 8 + 1] << (8 - bit % 8);
+  }
+  return {unpack_input(bits & 0x7), unpack_input((bits >> 3) & 0x7)};
+}
+
+bool ReplayReader::seek(const MapData &map, uint32_t frame, GameState &state) const {
+  if (!data || frame > header.frame_count || map.hash != header.map_hash) {
+    return false;
+  }
+  // the final frame of an episode that ends on the interval has no keyframe of its own
+  const uint32_t keyframe = std::min<uint32_t>(frame / header.keyframe_interval,
+                                               replay_keyframe_count(header) - 1);
+  std::memcpy(&state, keyframes + keyframe * sizeof(GameState), sizeof(GameState));
+  for (uint32_t f = keyframe * header.keyframe_interval; f < frame; ++f) {
+    const auto [p1_input, p2_input] = get_inputs(f);
+    step(map, state, p1_input, p2_input);
+  }
+  return true;
+}
+
+} // namespace jnb
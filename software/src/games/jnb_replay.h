@@ -0,0 +1,114 @@
+// compact episode recordings.
+// a replay is the inputs of every frame, packed 3 bits per player, plus a GameState keyframe
+// every keyframe_interval frames so any frame can be reached without simulating from the start.
+//
+// file layout (little-endian, native GameState layout):
+//   ReplayHeader
+//   GameState keyframes[replay_keyframe_count(header)], keyframe k is the state before frame
+//     k * keyframe_interval is stepped. there is one for every k * keyframe_interval <
+//     frame_count, and always one for the start state.
+//   uint8_t inputs[(frame_count * 6 + 7) / 8], frame f occupies bits 6f..6f+5, p1 in the low 3
+//     bits, p2 in the high 3, each with the pack_input layout
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "jnb.h"
+
+namespace jnb {
+
+static_assert(std::endian::native == std::endian::little, "replays are stored little-endian");
+
+constexpr uint32_t REPLAY_MAGIC = 0x524E424A; // "JNBR"
+constexpr uint16_t REPLAY_VERSION = 1;
+constexpr uint32_t REPLAY_DEFAULT_KEYFRAME_INTERVAL = 256;
+constexpr int REPLAY_BITS_PER_FRAME = 6;
+
+struct ReplayHeader {
+  uint32_t magic{REPLAY_MAGIC};
+  uint16_t version{REPLAY_VERSION};
+  uint16_t state_size{sizeof(GameState)}; // catches GameState layout changes
+  uint64_t map_hash{0};                   // MapData::hash of the map the episode was played on
+  uint64_t seed{0};
+  uint32_t frame_count{0};
+  uint32_t keyframe_interval{REPLAY_DEFAULT_KEYFRAME_INTERVAL};
+};
+static_assert(sizeof(ReplayHeader) == 32);
+static_assert(std::is_trivially_copyable_v<ReplayHeader>);
+
+// keyframes in a replay with this header, the start state and every k * keyframe_interval <
+// frame_count
+inline size_t replay_keyframe_count(const ReplayHeader &header) {
+  if (header.frame_count == 0) {
+    return 1;
+  }
+  return (header.frame_count - 1) / header.keyframe_interval + 1;
+}
+
+// builds a replay in memory while the episode is played, then writes it out in one go
+class ReplayWriter {
+public:
+  // start is the state the recording begins from, usually right after init
+  ReplayWriter(uint64_t map_hash, uint64_t seed, const GameState &start,
+               uint32_t keyframe_interval = REPLAY_DEFAULT_KEYFRAME_INTERVAL);
+
+  // call once per frame with the state before it is stepped and the inputs it is stepped with
+  void record(const GameState &state, const PlayerInput &p1_input, const PlayerInput &p2_input);
+
+  uint32_t get_frame_count() const {
+    return header.frame_count;
+  }
+
+  bool write(const std::string &filename) const;
+
+private:
+  ReplayHeader header{};
+  std::vector<GameState> keyframes{};
+  std::vector<uint8_t> inputs{};
+};
+
+// memory-maps a replay file. seeking restores the nearest keyframe at or before the frame and
+// re-simulates the rest, so it costs at most keyframe_interval - 1 steps.
+class ReplayReader {
+public:
+  ReplayReader() = default;
+  ~ReplayReader();
+  ReplayReader(const ReplayReader &) = delete;
+  ReplayReader &operator=(const ReplayReader &) = delete;
+
+  // prints the reason and returns false if the file is missing or not a valid replay
+  bool open(const std::string &filename);
+  void close();
+
+  const ReplayHeader &get_header() const {
+    return header;
+  }
+
+  uint32_t get_frame_count() const {
+    return header.frame_count;
+  }
+
+  // inputs of frame, which must be below get_frame_count()
+  std::pair<PlayerInput, PlayerInput> get_inputs(uint32_t frame) const;
+
+  // state after the first frame frames have been stepped, so frame == get_frame_count() gives
+  // the final state. returns false if frame is out of range or map is not the recorded map.
+  bool seek(const MapData &map, uint32_t frame, GameState &state) const;
+
+private:
+  const uint8_t *data{nullptr};
+  size_t size{0};
+  ReplayHeader header{};
+  const uint8_t *keyframes{nullptr};
+  const uint8_t *inputs{nullptr};
+#ifdef _WIN32
+  std::vector<uint8_t> file_data{}; // no mmap, the file is read in instead
+#endif
+};
+
+} // namespace jnb
@@ -0,0 +1,654 @@
+#include "jnb_simd.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include "jnb.h"
+
+// the kernels are written once per lane as branchless scalar code, used off x86 and for the
+// lanes left over at the end, and once over whole registers of int16 lanes with gcc vector
+// extensions, where comparisons give 0/-1 masks and `mask ? a : b` is a blend. on gcc/clang x86
+// the register version is compiled for the SSE2 baseline (8 lanes), AVX2 (16 lanes) and
+// AVX-512 (32 lanes), the only intrinsics being the map gathers, and picked at runtime.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JNB_SIMD_X86 1
+#define JNB_ALWAYS_INLINE inline __attribute__((always_inline))
+#include <immintrin.h>
+#else
+#define JNB_SIMD_X86 0
+#define JNB_ALWAYS_INLINE inline
+#endif
+
+namespace jnb::simd {
+
+static_assert(CELL_SIZE == 8, "tile_id below assumes 8 pixel tiles");
+
+namespace {
+
+// same as get_tile_id in jnb_step.h, without the branch
+JNB_ALWAYS_INLINE int tile_id(int pos) {
+  return std::max(pos >> 3, -1);
+}
+
+// raw value of F4(static_cast<int16_t>(pixels))
+JNB_ALWAYS_INLINE int16_t px_to_raw(int pixels) {
+  return static_cast<int16_t>(static_cast<int16_t>(pixels) << 4);
+}
+
+// the CollisionMap cells copied into a local for the same reason as PlayerView below
+struct MapView {
+  const uint8_t *cells;
+};
+
+JNB_ALWAYS_INLINE MapView view(const CollisionMap &m) {
+  return {m.cell_data()};
+}
+
+JNB_ALWAYS_INLINE uint8_t lookup(const MapView &m, int x, int y) {
+  return m.cells[CollisionMap::cell_index(x, y)];
+}
+
+JNB_ALWAYS_INLINE int16_t abs16(int16_t v) {
+  return static_cast<int16_t>(v >= 0 ? v : -v);
+}
+
+// the arrays of one player, copied out of Lanes before the loops. the kernels store to
+// uint8_t arrays, which may alias anything, so reading the pointers through Lanes inside the
+// loop would force a reload every iteration and block vectorization.
+struct PlayerView {
+  int16_t *x;
+  int16_t *y;
+  int16_t *x_vel;
+  int16_t *y_vel;
+  int32_t *score;
+  int32_t *dead_timeout;
+  uint8_t *queue_dead;
+  const uint8_t *actions;
+};
+
+JNB_ALWAYS_INLINE PlayerView view(const Lanes &l, int p) {
+  return {l.x[p],     l.y[p],            l.x_vel[p],      l.y_vel[p],
+          l.score[p], l.dead_timeout[p], l.queue_dead[p], l.actions + p * l.size};
+}
+
+JNB_ALWAYS_INLINE void phase_1_lane(const MapView &m, const PlayerView &pv,
+                                    const PlayerView &ov, const uint8_t *active, size_t i) {
+  const int16_t x = pv.x[i];
+  const int16_t y = pv.y[i];
+  const int16_t x_vel = pv.x_vel[i];
+  const int16_t y_vel = pv.y_vel[i];
+  const int32_t score = pv.score[i];
+  const uint8_t queue_dead = pv.queue_dead[i];
+  const int16_t other_x = ov.x[i];
+  const int16_t other_y = ov.y[i];
+  const int32_t other_dead_timeout = ov.dead_timeout[i];
+  const uint8_t input = pv.actions[i];
+
+  // bitwise & instead of && throughout, so that every load happens unconditionally and the
+  // loop stays free of control flow
+  const bool alive = (active[i] != 0) & (pv.dead_timeout[i] <= 0);
+
+  // tiles around the feet
+  const int x_low = x >> 4;
+  const int y_low = y >> 4;
+  const int x_tile_left = tile_id(x_low);
+  const int x_tile_right = tile_id(x_low + PLAYER_WIDTH - 1);
+  const int y_tile_down = tile_id(y_low);
+  const uint8_t feet = lookup(m, x_tile_left, y_tile_down) | lookup(m, x_tile_right, y_tile_down);
+  const uint8_t below =
+      lookup(m, x_tile_left, y_tile_down - 1) | lookup(m, x_tile_right, y_tile_down - 1);
+
+  const bool grounded = (px_to_raw(y_tile_down * CELL_SIZE) == y) & ((below & CLASS_SOLID) != 0);
+  const bool in_water = (feet & CLASS_WATER) != 0;
+  const bool on_ice = (below & CLASS_ICE) != 0;
+  const bool on_spring = (below & CLASS_SPRING) != 0;
+  const int16_t gravity = in_water ? GRAVITY_WATER.raw_value() : GRAVITY.raw_value();
+  const int16_t move_accel = on_ice ? MOVE_ACCEL_ICE.raw_value()
+                                    : (in_water ? MOVE_ACCEL_WATER.raw_value()
+                                                : MOVE_ACCEL.raw_value());
+
+  const bool left = (input & INPUT_LEFT) != 0;
+  const bool right = (input & INPUT_RIGHT) != 0;
+  const bool jump = (input & INPUT_JUMP) != 0;
+
+  // jump logic
+  const int16_t jump_vel = on_spring ? SPRING_VEL.raw_value() : (jump ? JUMP_VEL.raw_value() : y_vel);
+  int16_t fall_vel = static_cast<int16_t>(y_vel + gravity);
+  fall_vel = static_cast<int16_t>(fall_vel + (jump ? JUMP_MIDAIR_ACCEL.raw_value() : 0));
+  fall_vel = std::max(fall_vel, FALL_MAX_VEL.raw_value());
+  const int16_t new_y_vel = grounded ? jump_vel : fall_vel;
+
+  // horizontal acceleration or deceleration towards zero
+  const bool left_only = left & !right;
+  const bool right_only = right & !left;
+  const int16_t moved = left_only    ? static_cast<int16_t>(x_vel - move_accel)
+                        : right_only ? static_cast<int16_t>(x_vel + move_accel)
+                                     : x_vel;
+  const int16_t slowed = x_vel > 0 ? std::max<int16_t>(x_vel - move_accel, 0)
+                                   : std::min<int16_t>(x_vel + move_accel, 0);
+  const bool decelerate = !left_only & !right_only & grounded & !on_ice;
+  int16_t new_x_vel = decelerate ? slowed : moved;
+  new_x_vel = std::min(std::max(new_x_vel, static_cast<int16_t>(-MOVE_MAX_VEL.raw_value())),
+                       MOVE_MAX_VEL.raw_value());
+
+  // collision with the other player
+  constexpr int16_t height_raw = PLAYER_HEIGHT << 4;
+  constexpr int16_t width_raw = PLAYER_WIDTH << 4;
+  constexpr int16_t kill_raw = PLAYER_KILL_HEIGHT << 4;
+  const bool touching = (other_dead_timeout == 0) &
+                        (abs16(static_cast<int16_t>(y - other_y)) < height_raw) &
+                        (abs16(static_cast<int16_t>(x - other_x)) <= width_raw);
+  const bool die = touching & (other_y >= static_cast<int16_t>(y + kill_raw));
+  const bool kill = touching & !die & (y >= static_cast<int16_t>(other_y + kill_raw));
+  const int16_t diff = static_cast<int16_t>(other_x - x);
+  const int16_t push = x > other_x   ? static_cast<int16_t>(diff + width_raw)
+                       : x < other_x ? static_cast<int16_t>(diff - width_raw)
+                                     : 0;
+  new_x_vel = (touching & !kill) ? static_cast<int16_t>(new_x_vel + push) : new_x_vel;
+
+  pv.x_vel[i] = alive ? new_x_vel : x_vel;
+  pv.y_vel[i] = alive ? new_y_vel : y_vel;
+  pv.score[i] = alive ? score + (kill ? POINTS_PER_KILL : 0) : score;
+  pv.queue_dead[i] = alive ? static_cast<uint8_t>(queue_dead | die) : queue_dead;
+}
+
+JNB_ALWAYS_INLINE void phase_2_lane(const MapView &m, const PlayerView &pv,
+                                    const uint8_t *active_games, const uint8_t *coin_x,
+                                    const uint8_t *coin_y, uint8_t *coin_collected, size_t i) {
+  const int16_t x = pv.x[i];
+  const int16_t y = pv.y[i];
+  const int16_t x_vel = pv.x_vel[i];
+  const int16_t y_vel = pv.y_vel[i];
+  const int32_t score = pv.score[i];
+  const int32_t dead_timeout = pv.dead_timeout[i];
+  const uint8_t queue_dead = pv.queue_dead[i];
+
+  const bool active = active_games[i] != 0;
+  // dead_timeout == 1 means the player respawned this frame and simulates as normal
+  const bool run = active & (dead_timeout <= 1);
+
+  // tiles occupied before moving
+  const int x_low = x >> 4;
+  const int y_low = y >> 4;
+  const int x_tile_left = tile_id(x_low);
+  const int x_tile_right = tile_id(x_low + PLAYER_WIDTH - 1);
+  const int y_tile_down = tile_id(y_low);
+  const int y_tile_up = tile_id(y_low + PLAYER_HEIGHT - 1);
+
+  // integrate velocity
+  const int16_t xn = static_cast<int16_t>(x + x_vel);
+  const int16_t yn = static_cast<int16_t>(y + y_vel);
+  const int xn_low = xn >> 4;
+  const int yn_low = yn >> 4;
+  const int xn_tile_left = tile_id(xn_low);
+  const int xn_tile_right = tile_id(xn_low + PLAYER_WIDTH - 1);
+  const int yn_tile_down = tile_id(yn_low);
+  const int yn_tile_up = tile_id(yn_low + PLAYER_HEIGHT - 1);
+
+  // left/right collisions
+  const uint8_t left_side =
+      lookup(m, xn_tile_left, y_tile_down) | lookup(m, xn_tile_left, y_tile_up);
+  const uint8_t right_side =
+      lookup(m, xn_tile_right, y_tile_down) | lookup(m, xn_tile_right, y_tile_up);
+  const bool hit_left = (x_vel < 0) & ((left_side & CLASS_SOLID) != 0);
+  const bool hit_right = (x_vel > 0) & ((right_side & CLASS_SOLID) != 0);
+  const int16_t new_x = hit_left    ? px_to_raw((xn_tile_left + 1) * CELL_SIZE)
+                        : hit_right ? px_to_raw(xn_tile_right * CELL_SIZE - PLAYER_WIDTH)
+                                    : xn;
+  const int16_t new_x_vel = (hit_left | hit_right) ? 0 : x_vel;
+
+  // down/up collisions
+  const uint8_t down_side =
+      lookup(m, x_tile_left, yn_tile_down) | lookup(m, x_tile_right, yn_tile_down);
+  const uint8_t up_side = lookup(m, x_tile_left, yn_tile_up) | lookup(m, x_tile_right, yn_tile_up);
+  const bool hit_down = (y_vel < 0) & ((down_side & CLASS_SOLID) != 0);
+  const bool hit_up = (y_vel > 0) & ((up_side & CLASS_SOLID) != 0);
+  const int16_t new_y = hit_down ? px_to_raw((yn_tile_down + 1) * CELL_SIZE)
+                        : hit_up ? px_to_raw(yn_tile_up * CELL_SIZE - PLAYER_HEIGHT)
+                                 : yn;
+  const int16_t new_y_vel = (hit_down | hit_up) ? 0 : y_vel;
+
+  // coin pickup
+  const int x_center = static_cast<int16_t>((new_x + 8) >> 4) + PLAYER_WIDTH / 2;
+  const int y_center = static_cast<int16_t>((new_y + 8) >> 4) + PLAYER_HEIGHT / 2;
+  const bool coin = (tile_id(x_center) == coin_x[i]) & (tile_id(y_center) == coin_y[i]);
+
+  const int32_t waiting_timeout = dead_timeout > 1 ? dead_timeout - 1 : dead_timeout;
+  const int32_t run_timeout = queue_dead ? DEAD_TIMEOUT : 0;
+
+  pv.x[i] = run ? new_x : x;
+  pv.y[i] = run ? new_y : y;
+  pv.x_vel[i] = run ? new_x_vel : x_vel;
+  pv.y_vel[i] = run ? new_y_vel : y_vel;
+  pv.score[i] = run ? score + (coin ? POINTS_PER_COIN : 0) : score;
+  pv.queue_dead[i] = run ? 0 : queue_dead;
+  pv.dead_timeout[i] = run ? run_timeout : (active ? waiting_timeout : dead_timeout);
+  coin_collected[i] |= static_cast<uint8_t>(run & coin);
+}
+
+#if JNB_SIMD_X86
+// everything down to the entry points is inlined into them, so no vector crosses a call. gcc
+// reports these at the end of the file, so the warning stays off from here on.
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+// N int16 lanes per register. wider fields are converted on load and store: dead_timeout never
+// leaves 0..DEAD_TIMEOUT, and only the score is added to at 32 bits. masks stay 16 bit, gcc
+// splits 32 bit compares and blends wider than a register back into scalar code.
+template <int N>
+struct Vec {
+  typedef int16_t i16 __attribute__((vector_size(N * 2)));
+  typedef int32_t i32 __attribute__((vector_size(N * 4)));
+  typedef uint8_t u8 __attribute__((vector_size(N)));
+  typedef int8_t i8 __attribute__((vector_size(N)));
+};
+
+// cells of N tile indices. the gather loads 32 bits at every cell's byte offset, the padding
+// after the last cell keeps that in bounds, and the low byte is the cell.
+// outputs by reference, so the kernels below never pass vectors by value across targets.
+struct Avx2 {
+  static constexpr int N = 16;
+  using V = Vec<N>;
+
+  __attribute__((target("avx2"))) static inline void gather(const uint8_t *cells,
+                                                            const V::i16 &index, V::i16 &out) {
+    const __m256i i = reinterpret_cast<const __m256i &>(index);
+    const __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(i));
+    const __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(i, 1));
+    const __m256i byte = _mm256_set1_epi32(0xFF);
+    const __m256i c_lo = _mm256_and_si256(
+        _mm256_i32gather_epi32(reinterpret_cast<const int *>(cells), lo, 1), byte);
+    const __m256i c_hi = _mm256_and_si256(
+        _mm256_i32gather_epi32(reinterpret_cast<const int *>(cells), hi, 1), byte);
+    // packus works within 128 bit halves, the permute puts the four quarters back in order
+    const __m256i packed = _mm256_packus_epi32(c_lo, c_hi);
+    reinterpret_cast<__m256i &>(out) = _mm256_permute4x64_epi64(packed, 0xD8);
+  }
+};
+
+struct Avx512 {
+  static constexpr int N = 32;
+  using V = Vec<N>;
+
+  __attribute__((target("avx512f,avx512bw"))) static inline void
+  gather(const uint8_t *cells, const V::i16 &index, V::i16 &out) {
+    const __m512i i = reinterpret_cast<const __m512i &>(index);
+    const __m512i lo = _mm512_cvtepi16_epi32(_mm512_extracti64x4_epi64(i, 0));
+    const __m512i hi = _mm512_cvtepi16_epi32(_mm512_extracti64x4_epi64(i, 1));
+    // vpmovdw truncates, the mask drops the three bytes after each cell
+    const __m256i c_lo = _mm512_cvtepi32_epi16(_mm512_i32gather_epi32(lo, cells, 1));
+    const __m256i c_hi = _mm512_cvtepi32_epi16(_mm512_i32gather_epi32(hi, cells, 1));
+    const __m512i both = _mm512_inserti64x4(_mm512_castsi256_si512(c_lo), c_hi, 1);
+    reinterpret_cast<__m512i &>(out) = _mm512_and_si512(both, _mm512_set1_epi16(0xFF));
+  }
+};
+
+// the baseline width, 8 lanes of SSE2, which every x86-64 target has. there is no gather
+// before AVX2, so the cells are read one lane at a time.
+struct Sse2 {
+  static constexpr int N = 8;
+  using V = Vec<N>;
+
+  static JNB_ALWAYS_INLINE void gather(const uint8_t *cells, const V::i16 &index, V::i16 &out) {
+    for (int l = 0; l < N; ++l) {
+      out[l] = cells[index[l]];
+    }
+  }
+};
+
+template <typename T>
+JNB_ALWAYS_INLINE T load(const void *p) {
+  T v;
+  std::memcpy(&v, p, sizeof(T));
+  return v;
+}
+
+template <typename T>
+JNB_ALWAYS_INLINE void store(void *p, const T &v) {
+  std::memcpy(p, &v, sizeof(T));
+}
+
+template <typename T>
+JNB_ALWAYS_INLINE T max_v(const T &a, const T &b) {
+  return a > b ? a : b;
+}
+
+template <typename T>
+JNB_ALWAYS_INLINE T min_v(const T &a, const T &b) {
+  return a < b ? a : b;
+}
+
+// 0/-1 per lane for whether the byte at p is nonzero. the compare is done on the bytes and the
+// mask widened after, since gcc narrows a compare of widened bytes back to bytes, and scalarizes
+// blending that with 16 bit masks.
+template <typename V>
+JNB_ALWAYS_INLINE typename V::i16 nonzero_v(const uint8_t *p) {
+  const typename V::i8 mask = load<typename V::u8>(p) != 0;
+  return __builtin_convertvector(mask, typename V::i16);
+}
+
+// tile_id on every lane
+template <typename T>
+JNB_ALWAYS_INLINE T tile_id_v(const T &pos) {
+  return max_v<T>(pos >> 3, T{} - 1);
+}
+
+// lookup on every lane, x and y as tile coordinates
+template <typename G>
+JNB_ALWAYS_INLINE typename G::V::i16 lookup_v(const MapView &m, const typename G::V::i16 &x,
+                                              const typename G::V::i16 &y) {
+  using i16 = typename G::V::i16;
+  const i16 cx = min_v<i16>(max_v<i16>(x, i16{} - 1), i16{} + CollisionMap::MAX_COLUMN) + 1;
+  const i16 cy =
+      min_v<i16>(max_v<i16>(y, i16{} - 1), i16{} + static_cast<int>(MAP_MAX_SIZE_TILES)) + 1;
+  const i16 index = cy * CollisionMap::COLUMN_COUNT + cx;
+  i16 cells;
+  G::gather(m.cells, index, cells);
+  return cells;
+}
+
+// phase_1_lane for the N lanes from i. masks are 0/-1 per lane and combined with & and |.
+template <typename G>
+JNB_ALWAYS_INLINE void phase_1_block(const MapView &m, const PlayerView &pv,
+                                     const PlayerView &ov, const uint8_t *active, size_t i) {
+  using i16 = typename G::V::i16;
+  using i32 = typename G::V::i32;
+  using u8 = typename G::V::u8;
+  const i16 zero{};
+
+  const i16 x = load<i16>(pv.x + i);
+  const i16 y = load<i16>(pv.y + i);
+  const i16 x_vel = load<i16>(pv.x_vel + i);
+  const i16 y_vel = load<i16>(pv.y_vel + i);
+  const i32 score = load<i32>(pv.score + i);
+  const i16 queue_dead = nonzero_v<typename G::V>(pv.queue_dead + i);
+  const i16 other_x = load<i16>(ov.x + i);
+  const i16 other_y = load<i16>(ov.y + i);
+  const i16 input = __builtin_convertvector(load<u8>(pv.actions + i), i16);
+  const i16 alive = nonzero_v<typename G::V>(active + i) &
+                    (__builtin_convertvector(load<i32>(pv.dead_timeout + i), i16) <= 0);
+  const i16 other_alive = __builtin_convertvector(load<i32>(ov.dead_timeout + i), i16) == 0;
+
+  // tiles around the feet
+  const i16 x_low = x >> 4;
+  const i16 y_low = y >> 4;
+  const i16 x_tile_left = tile_id_v(x_low);
+  const i16 x_tile_right = tile_id_v<i16>(x_low + (PLAYER_WIDTH - 1));
+  const i16 y_tile_down = tile_id_v(y_low);
+  const i16 feet = lookup_v<G>(m, x_tile_left, y_tile_down) |
+                   lookup_v<G>(m, x_tile_right, y_tile_down);
+  const i16 below = lookup_v<G>(m, x_tile_left, y_tile_down - 1) |
+                    lookup_v<G>(m, x_tile_right, y_tile_down - 1);
+
+  const i16 grounded = (((y_tile_down * CELL_SIZE) << 4) == y) & ((below & CLASS_SOLID) != 0);
+  const i16 in_water = (feet & CLASS_WATER) != 0;
+  const i16 on_ice = (below & CLASS_ICE) != 0;
+  const i16 on_spring = (below & CLASS_SPRING) != 0;
+  const i16 gravity = in_water ? zero + GRAVITY_WATER.raw_value() : zero + GRAVITY.raw_value();
+  const i16 move_accel =
+      on_ice ? zero + MOVE_ACCEL_ICE.raw_value()
+             : (in_water ? zero + MOVE_ACCEL_WATER.raw_value() : zero + MOVE_ACCEL.raw_value());
+
+  const i16 left = (input & INPUT_LEFT) != 0;
+  const i16 right = (input & INPUT_RIGHT) != 0;
+  const i16 jump = (input & INPUT_JUMP) != 0;
+
+  // jump logic
+  const i16 jump_vel =
+      on_spring ? zero + SPRING_VEL.raw_value() : (jump ? zero + JUMP_VEL.raw_value() : y_vel);
+  i16 fall_vel = y_vel + gravity + (jump & JUMP_MIDAIR_ACCEL.raw_value());
+  fall_vel = max_v<i16>(fall_vel, zero + FALL_MAX_VEL.raw_value());
+  const i16 new_y_vel = grounded ? jump_vel : fall_vel;
+
+  // horizontal acceleration or deceleration towards zero
+  const i16 left_only = left & ~right;
+  const i16 right_only = right & ~left;
+  const i16 moved = left_only ? x_vel - move_accel : (right_only ? x_vel + move_accel : x_vel);
+  const i16 slowed =
+      x_vel > 0 ? max_v<i16>(x_vel - move_accel, zero) : min_v<i16>(x_vel + move_accel, zero);
+  const i16 decelerate = ~left_only & ~right_only & grounded & ~on_ice;
+  i16 new_x_vel = decelerate ? slowed : moved;
+  new_x_vel = min_v<i16>(max_v<i16>(new_x_vel, zero - MOVE_MAX_VEL.raw_value()),
+                         zero + MOVE_MAX_VEL.raw_value());
+
+  // collision with the other player
+  constexpr int16_t height_raw = PLAYER_HEIGHT << 4;
+  constexpr int16_t width_raw = PLAYER_WIDTH << 4;
+  constexpr int16_t kill_raw = PLAYER_KILL_HEIGHT << 4;
+  const i16 dy = y - other_y;
+  const i16 dx = x - other_x;
+  const i16 touching = other_alive & ((dy >= 0 ? dy : -dy) < height_raw) &
+                       ((dx >= 0 ? dx : -dx) <= width_raw);
+  const i16 die = touching & (other_y >= y + kill_raw);
+  const i16 kill = touching & ~die & (y >= other_y + kill_raw);
+  const i16 diff = other_x - x;
+  const i16 push = x > other_x ? diff + width_raw : (x < other_x ? diff - width_raw : zero);
+  new_x_vel = new_x_vel + (touching & ~kill & push);
+
+  store(pv.x_vel + i, alive ? new_x_vel : x_vel);
+  store(pv.y_vel + i, alive ? new_y_vel : y_vel);
+  const i32 kill_points = __builtin_convertvector(alive & kill & POINTS_PER_KILL, i32);
+  store(pv.score + i, score + kill_points);
+  store(pv.queue_dead + i, __builtin_convertvector((queue_dead | (alive & die)) & 1, u8));
+}
+
+// phase_2_lane for the N lanes from i
+template <typename G>
+JNB_ALWAYS_INLINE void phase_2_block(const MapView &m, const PlayerView &pv,
+                                     const uint8_t *active_games, const uint8_t *coin_x,
+                                     const uint8_t *coin_y, uint8_t *coin_collected, size_t i) {
+  using i16 = typename G::V::i16;
+  using i32 = typename G::V::i32;
+  using u8 = typename G::V::u8;
+  const i16 zero{};
+
+  const i16 x = load<i16>(pv.x + i);
+  const i16 y = load<i16>(pv.y + i);
+  const i16 x_vel = load<i16>(pv.x_vel + i);
+  const i16 y_vel = load<i16>(pv.y_vel + i);
+  const i32 score = load<i32>(pv.score + i);
+  const i16 dead_timeout = __builtin_convertvector(load<i32>(pv.dead_timeout + i), i16);
+  const i16 queue_dead = nonzero_v<typename G::V>(pv.queue_dead + i);
+
+  const i16 active = nonzero_v<typename G::V>(active_games + i);
+  // dead_timeout == 1 means the player respawned this frame and simulates as normal
+  const i16 run = active & (dead_timeout <= 1);
+
+  // tiles occupied before moving
+  const i16 x_low = x >> 4;
+  const i16 y_low = y >> 4;
+  const i16 x_tile_left = tile_id_v(x_low);
+  const i16 x_tile_right = tile_id_v<i16>(x_low + (PLAYER_WIDTH - 1));
+  const i16 y_tile_down = tile_id_v(y_low);
+  const i16 y_tile_up = tile_id_v<i16>(y_low + (PLAYER_HEIGHT - 1));
+
+  // integrate velocity
+  const i16 xn = x + x_vel;
+  const i16 yn = y + y_vel;
+  const i16 xn_low = xn >> 4;
+  const i16 yn_low = yn >> 4;
+  const i16 xn_tile_left = tile_id_v(xn_low);
+  const i16 xn_tile_right = tile_id_v<i16>(xn_low + (PLAYER_WIDTH - 1));
+  const i16 yn_tile_down = tile_id_v(yn_low);
+  const i16 yn_tile_up = tile_id_v<i16>(yn_low + (PLAYER_HEIGHT - 1));
+
+  // left/right collisions
+  const i16 left_side =
+      lookup_v<G>(m, xn_tile_left, y_tile_down) | lookup_v<G>(m, xn_tile_left, y_tile_up);
+  const i16 right_side =
+      lookup_v<G>(m, xn_tile_right, y_tile_down) | lookup_v<G>(m, xn_tile_right, y_tile_up);
+  const i16 hit_left = (x_vel < 0) & ((left_side & CLASS_SOLID) != 0);
+  const i16 hit_right = (x_vel > 0) & ((right_side & CLASS_SOLID) != 0);
+  const i16 new_x =
+      hit_left ? ((xn_tile_left + 1) * CELL_SIZE) << 4
+               : (hit_right ? (xn_tile_right * CELL_SIZE - PLAYER_WIDTH) << 4 : xn);
+  const i16 new_x_vel = (hit_left | hit_right) ? zero : x_vel;
+
+  // down/up collisions
+  const i16 down_side =
+      lookup_v<G>(m, x_tile_left, yn_tile_down) | lookup_v<G>(m, x_tile_right, yn_tile_down);
+  const i16 up_side =
+      lookup_v<G>(m, x_tile_left, yn_tile_up) | lookup_v<G>(m, x_tile_right, yn_tile_up);
+  const i16 hit_down = (y_vel < 0) & ((down_side & CLASS_SOLID) != 0);
+  const i16 hit_up = (y_vel > 0) & ((up_side & CLASS_SOLID) != 0);
+  const i16 new_y =
+      hit_down ? ((yn_tile_down + 1) * CELL_SIZE) << 4
+               : (hit_up ? (yn_tile_up * CELL_SIZE - PLAYER_HEIGHT) << 4 : yn);
+  const i16 new_y_vel = (hit_down | hit_up) ? zero : y_vel;
+
+  // coin pickup. (v + 8) >> 4 would overflow int16 near the top of the range, halving first
+  // gives the same floor((v + 8) / 16) without it
+  const i16 x_center = (((new_x >> 1) + 4) >> 3) + PLAYER_WIDTH / 2;
+  const i16 y_center = (((new_y >> 1) + 4) >> 3) + PLAYER_HEIGHT / 2;
+  const i16 coin = (tile_id_v(x_center) == __builtin_convertvector(load<u8>(coin_x + i), i16)) &
+                   (tile_id_v(y_center) == __builtin_convertvector(load<u8>(coin_y + i), i16));
+
+  // true masks are -1, so adding one counts down
+  const i16 waiting_timeout = dead_timeout + (dead_timeout > 1);
+  const i16 run_timeout = queue_dead & DEAD_TIMEOUT;
+
+  store(pv.x + i, run ? new_x : x);
+  store(pv.y + i, run ? new_y : y);
+  store(pv.x_vel + i, run ? new_x_vel : x_vel);
+  store(pv.y_vel + i, run ? new_y_vel : y_vel);
+  store(pv.score + i, score + __builtin_convertvector(run & coin & POINTS_PER_COIN, i32));
+  store(pv.queue_dead + i, __builtin_convertvector(~run & queue_dead & 1, u8));
+  const i16 new_dead_timeout = run ? run_timeout : (active ? waiting_timeout : dead_timeout);
+  store(pv.dead_timeout + i, __builtin_convertvector(new_dead_timeout, i32));
+  const u8 collected = load<u8>(coin_collected + i) | __builtin_convertvector(run & coin & 1, u8);
+  store(coin_collected + i, collected);
+}
+#endif
+
+// p2 reads p1's position and dead timeout in phase 1, neither of which phase 1 writes,
+// so the players can be done one after another like update_players does.
+// G is the register width, void for one lane at a time.
+template <typename G>
+JNB_ALWAYS_INLINE void phase_1_impl(const CollisionMap &map, const Lanes &l) {
+  const MapView m = view(map);
+  for (int p = 0; p < 2; ++p) {
+    const PlayerView pv = view(l, p);
+    const PlayerView ov = view(l, 1 - p);
+    size_t i = 0;
+#if JNB_SIMD_X86
+    if constexpr (!std::is_void_v<G>) {
+      for (; i + G::N <= l.size; i += G::N) {
+        phase_1_block<G>(m, pv, ov, l.active, i);
+      }
+    }
+#endif
+    for (; i < l.size; ++i) {
+      phase_1_lane(m, pv, ov, l.active, i);
+    }
+  }
+}
+
+template <typename G>
+JNB_ALWAYS_INLINE void phase_2_impl(const CollisionMap &map, const Lanes &l,
+                                    uint8_t *coin_collected) {
+  const MapView m = view(map);
+  std::fill_n(coin_collected, l.size, 0);
+  for (int p = 0; p < 2; ++p) {
+    const PlayerView pv = view(l, p);
+    size_t i = 0;
+#if JNB_SIMD_X86
+    if constexpr (!std::is_void_v<G>) {
+      for (; i + G::N <= l.size; i += G::N) {
+        phase_2_block<G>(m, pv, l.active, l.coin_x, l.coin_y, coin_collected, i);
+      }
+    }
+#endif
+    for (; i < l.size; ++i) {
+      phase_2_lane(m, pv, l.active, l.coin_x, l.coin_y, coin_collected, i);
+    }
+  }
+}
+
+#if JNB_SIMD_X86 && defined(__SSE2__)
+using Baseline = Sse2;
+#else
+using Baseline = void;
+#endif
+
+void phase_1_generic(const CollisionMap &m, const Lanes &l) {
+  phase_1_impl<Baseline>(m, l);
+}
+
+void phase_2_generic(const CollisionMap &m, const Lanes &l, uint8_t *coin_collected) {
+  phase_2_impl<Baseline>(m, l, coin_collected);
+}
+
+#if JNB_SIMD_X86
+// the type of a compare mask is picked when a template is instantiated. implicit instantiations
+// are deferred to the end of the file, under the default target, which has no AVX-512 mask
+// registers, and gcc would split every 32 lane compare into scalar code. instantiating them
+// here picks the masks, and the function target, under AVX-512 instead.
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw")
+template void phase_1_block<Avx512>(const MapView &, const PlayerView &, const PlayerView &,
+                                    const uint8_t *, size_t);
+template void phase_2_block<Avx512>(const MapView &, const PlayerView &, const uint8_t *,
+                                    const uint8_t *, const uint8_t *, uint8_t *, size_t);
+template void phase_1_impl<Avx512>(const CollisionMap &, const Lanes &);
+template void phase_2_impl<Avx512>(const CollisionMap &, const Lanes &, uint8_t *);
+#pragma GCC pop_options
+
+// flatten pulls the gathers into these, where their target matches
+__attribute__((target("avx2"), flatten)) void phase_1_avx2(const CollisionMap &m,
+                                                           const Lanes &l) {
+  phase_1_impl<Avx2>(m, l);
+}
+
+__attribute__((target("avx2"), flatten)) void phase_2_avx2(const CollisionMap &m,
+                                                           const Lanes &l,
+                                                           uint8_t *coin_collected) {
+  phase_2_impl<Avx2>(m, l, coin_collected);
+}
+
+__attribute__((target("avx512f,avx512bw"), flatten)) void phase_1_avx512(const CollisionMap &m,
+                                                                         const Lanes &l) {
+  phase_1_impl<Avx512>(m, l);
+}
+
+__attribute__((target("avx512f,avx512bw"), flatten)) void
+phase_2_avx512(const CollisionMap &m, const Lanes &l, uint8_t *coin_collected) {
+  phase_2_impl<Avx512>(m, l, coin_collected);
+}
+#endif
+
+} // namespace
+
+// SCALAR runs the same kernel compiled for the baseline target
+void phase_1(Isa isa, const CollisionMap &map, const Lanes &lanes) {
+  switch (isa) {
+#if JNB_SIMD_X86
+    case Isa::AVX512:
+      phase_1_avx512(map, lanes);
+      break;
+    case Isa::AVX2:
+      phase_1_avx2(map, lanes);
+      break;
+#endif
+    default:
+      phase_1_generic(map, lanes);
+      break;
+  }
+}
+
+void phase_2(Isa isa, const CollisionMap &map, const Lanes &lanes, uint8_t *coin_collected) {
+  switch (isa) {
+#if JNB_SIMD_X86
+    case Isa::AVX512:
+      phase_2_avx512(map, lanes, coin_collected);
+      break;
+    case Isa::AVX2:
+      phase_2_avx2(map, lanes, coin_collected);
+      break;
+#endif
+    default:
+      phase_2_generic(map, lanes, coin_collected);
+      break;
+  }
+}
+
+} // namespace jnb::simd
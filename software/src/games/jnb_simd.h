@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "collision_map.h"
+#include "cpu_isa.h"
+
+// branchless, wide versions of the JnB player phases for stepping many games at once.
+// every lane is one game, 8 (x86-64 baseline), 16 (AVX2) or 32 (AVX-512) per register. results
+// are bit-identical to update_players().
+namespace jnb::simd {
+
+using cpu::Isa;
+using cpu::detect_isa;
+using cpu::isa_name;
+
+// tile class bits of CollisionMap::cell
+constexpr uint8_t CLASS_SOLID = 1 << CollisionMap::SOLID;
+constexpr uint8_t CLASS_WATER = 1 << CollisionMap::WATER;
+constexpr uint8_t CLASS_ICE = 1 << CollisionMap::ICE;
+constexpr uint8_t CLASS_SPRING = 1 << CollisionMap::SPRING;
+
+// raw pointers into structure-of-arrays game state. player arrays are indexed [player][game].
+struct Lanes {
+  size_t size{0};
+  int16_t *x[2]{};
+  int16_t *y[2]{};
+  int16_t *x_vel[2]{};
+  int16_t *y_vel[2]{};
+  int32_t *score[2]{};
+  int32_t *dead_timeout[2]{};
+  uint8_t *queue_dead[2]{};
+  const uint8_t *coin_x{nullptr};
+  const uint8_t *coin_y{nullptr};
+  const uint8_t *active{nullptr};  // games with active == 0 are left untouched
+  const uint8_t *actions{nullptr}; // packed input bits, [player * size + game]
+};
+
+// phase 1 for both players: ground/water/ice tests, jump, acceleration and player collision
+void phase_1(Isa isa, const CollisionMap &map, const Lanes &lanes);
+
+// phase 2 for both players: dead timeout, integration, tile collision and coin pickup.
+// respawn positions must already be written for players whose dead_timeout is 1, since
+// drawing them needs the per-game rng. coin_collected[game] is set if either player touched
+// the coin.
+void phase_2(Isa isa, const CollisionMap &map, const Lanes &lanes, uint8_t *coin_collected);
+
+} // namespace jnb::simd
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <bit>
+
+#include "collision_map.h"
+#include "jnb.h"
+#include "parse_map.h"
+
+// the JnB frame update as plain inline functions. nothing here allocates or goes through
+// type erasure, so it is cheap enough to call once per frame for every game in a population.
+// JnBGame, JnBBatch and the benchmarks all advance their state through this header.
+namespace jnb {
+
+// tile coordinate of a pixel coordinate.
+// in our case, just returning -1 for negative positions is fine, since the player will
+// never make it past -1 in any case.
+constexpr int get_tile_id(int pos) {
+  return pos >= 0 ? pos / CELL_SIZE : -1;
+}
+
+// pick a spawn tile from 32 random bits, same as sample_spawn in game_types.vhd
+constexpr TilePos sample_spawn(const TileMap &map, uint32_t bits) {
+  const size_t num_spawn = map.spawns.size();
+  // grab num_spawn_bits = ceil(log2(num_spawn)) bits from the rng
+  const int num_spawn_bits = std::bit_width(num_spawn - 1);
+  size_t index = bits & ((uint32_t{1} << num_spawn_bits) - 1);
+  // reduce it if its over the max
+  if (index >= num_spawn) {
+    index -= num_spawn;
+  }
+  return map.spawns[index];
+}
+
+// seed the rng and pick the coin position and both player spawns for a fresh round.
+// follows INIT_S in game.vhd: the spawn tiles are registered from the rng output two cycles
+// before the rng stops, and p2 may spawn on p1 just like on the PL.
+constexpr void spawn_initial(const TileMap &map, GameRng &rng, uint32_t seed, TilePos &coin_pos,
+                             Player &p1, Player &p2) {
+  rng.seed(seed);
+  for (int i = 0; i < RNG_INIT_CYCLES - 1; ++i) {
+    rng.advance();
+  }
+  const TilePos p1_spawn = sample_spawn(map, rng.result(RNG_STREAM_P1));
+  const TilePos p2_spawn = sample_spawn(map, rng.result(RNG_STREAM_P2));
+  coin_pos = sample_spawn(map, rng.result(RNG_STREAM_COIN));
+  rng.advance();
+  rng.advance();
+
+  p1.x = F4(static_cast<int16_t>(p1_spawn.x * CELL_SIZE));
+  p1.y = F4(static_cast<int16_t>(p1_spawn.y * CELL_SIZE));
+  p2.x = F4(static_cast<int16_t>(p2_spawn.x * CELL_SIZE));
+  p2.y = F4(static_cast<int16_t>(p2_spawn.y * CELL_SIZE));
+}
+
+// tile coordinates and tile classes around a player, sampled once at the start of the frame.
+// these values will be computed combinatorially on FPGA.
+struct PlayerTiles {
+  int x_tile_left{0};  // tile x coord containing left side of player
+  int x_tile_right{0}; // tile x coord containing right side of player
+  int y_tile_down{0};  // tile y coord containing bottom of player
+  int y_tile_up{0};    // tile y coord containing top of player
+  bool on_solid{false};  // something stand-able below either foot
+  bool in_water{false};  // either foot is in water
+  bool on_ice{false};    // ice below either foot
+  bool on_spring{false}; // spring below either foot
+};
+
+constexpr PlayerTiles sample_player_tiles(const Player &p, const CollisionMap &collision) {
+  // x_low and y_low is the bottom left of the player, in pixels
+  const int x_low = p.x.to_integer_floor();
+  const int y_low = p.y.to_integer_floor();
+
+  PlayerTiles t;
+  t.x_tile_left = get_tile_id(x_low);
+  t.x_tile_right = get_tile_id(x_low + PLAYER_WIDTH - 1);
+  t.y_tile_down = get_tile_id(y_low);
+  t.y_tile_up = get_tile_id(y_low + PLAYER_HEIGHT - 1);
+
+  // have the tile coordinates, now we can test the tiles our feet are in and above
+  const int l = t.x_tile_left, r = t.x_tile_right, below = t.y_tile_down - 1;
+  t.on_solid = collision.test_any(CollisionMap::SOLID, l, r, below);
+  t.in_water = collision.test_any(CollisionMap::WATER, l, r, t.y_tile_down);
+  t.on_ice = collision.test_any(CollisionMap::ICE, l, r, below);
+  t.on_spring = collision.test_any(CollisionMap::SPRING, l, r, below);
+  return t;
+}
+
+// phase 1: grounded/water/ice tests, jumping, acceleration and collision with the other player.
+// does not move either player, so both players can run it independently.
+constexpr void player_phase_1(Player &p, const Player &other, const PlayerTiles &t,
+                              const PlayerInput &input) {
+  // early return if dead
+  if (p.dead_timeout > 0)
+    return;
+  // determine if the player is grounded
+  bool grounded = false;
+  if (F4(static_cast<int16_t>(t.y_tile_down * CELL_SIZE)) == p.y) {
+    // we are on the bottom of a tile,
+    // so check if we are on something stand-able...
+    if (t.on_solid) {
+      grounded = true;
+    }
+  }
+
+  // determine acceleration based on context
+  const F4 gravity = t.in_water ? GRAVITY_WATER : GRAVITY;
+  const F4 move_accel =
+      t.on_ice ? MOVE_ACCEL_ICE : (t.in_water ? MOVE_ACCEL_WATER : MOVE_ACCEL);
+
+  // jump logic
+  if (grounded) {
+    if (t.on_spring) {
+      p.y_vel = SPRING_VEL;
+    } else if (input.jump) {
+      p.y_vel = JUMP_VEL;
+    }
+  } else { // not grounded. accelerate due to gravity
+    p.y_vel += gravity;
+    // if jump is held, also accelerate up a little to 'float'
+    if (input.jump) {
+      p.y_vel += JUMP_MIDAIR_ACCEL;
+    }
+    // limit y_vel
+    if (p.y_vel < FALL_MAX_VEL) {
+      p.y_vel = FALL_MAX_VEL;
+    }
+  }
+
+  // accelerate x_vel based on input
+  if (input.left && !input.right) {
+    // accel left
+    p.x_vel -= move_accel;
+  } else if (input.right && !input.left) {
+    // accel right
+    p.x_vel += move_accel;
+  } else {
+    // decelerate towards zero if grounded and not on ice
+    if (grounded && !t.on_ice) {
+      if (p.x_vel > F4_ZERO) {
+        // check if we have room to do the full speed reduction
+        if (p.x_vel >= move_accel) {
+          p.x_vel -= move_accel;
+        } else {
+          // we are too slow to do the full speed reduction
+          p.x_vel = F4_ZERO;
+        }
+      } else if (p.x_vel < F4_ZERO) {
+        // check if we have room to do the full speed reduction
+        if (p.x_vel <= -move_accel) {
+          p.x_vel += move_accel;
+        } else {
+          // we are too slow to do the full speed reduction
+          p.x_vel = F4_ZERO;
+        }
+      }
+    }
+  }
+
+  // limit x velocity
+  if (p.x_vel < -MOVE_MAX_VEL) {
+    p.x_vel = -MOVE_MAX_VEL;
+  }
+  if (p.x_vel > MOVE_MAX_VEL) {
+    p.x_vel = MOVE_MAX_VEL;
+  }
+
+  // accelerate based on collision with other player
+  // just push away in the horizontal axis during collision
+  // HACK: because these phases run sequentially on CPU,
+  // this player might die and be skipped by the next phase, which
+  // is asymmetric
+  if (other.dead_timeout == 0) { // only run if opponent is alive
+    if ((p.y - other.y).abs() < F4(static_cast<int16_t>(PLAYER_HEIGHT))) {
+      if ((p.x - other.x).abs() <= F4(static_cast<int16_t>(PLAYER_WIDTH))) {
+        bool accel = true;
+        // if other player is significantly above this one, die
+        if (other.y >= p.y + F4(static_cast<int16_t>(PLAYER_KILL_HEIGHT))) {
+          p.queue_dead = true;
+        }
+        // if the opposite is true, gain a point
+        else if (p.y >= other.y + F4(static_cast<int16_t>(PLAYER_KILL_HEIGHT))) {
+          p.score += POINTS_PER_KILL;
+          accel = false;
+        }
+        if (accel) {
+          if (p.x > other.x) {
+            p.x_vel += (other.x - p.x + F4(static_cast<int16_t>(PLAYER_WIDTH)));
+          } else if (p.x < other.x) {
+            p.x_vel += (other.x - p.x - F4(static_cast<int16_t>(PLAYER_WIDTH)));
+          }
+        }
+      }
+    }
+  }
+}
+
+// phase 2: dead timeout and respawn, integration, tile collision and coin pickup.
+// spawn_pos is where the player goes if it respawns this frame.
+// returns true if this player touched the coin.
+constexpr bool player_phase_2(Player &p, const PlayerTiles &t, const CollisionMap &collision,
+                              const TilePos &coin_pos, const TilePos &spawn_pos) {
+  // early return if dead
+  if (p.dead_timeout > 1) {
+    p.dead_timeout--;
+    return false;
+  } else if (p.dead_timeout == 1) {
+    p.dead_timeout--;
+    // respawn
+    p.x = F4(static_cast<int16_t>(spawn_pos.x * CELL_SIZE));
+    p.y = F4(static_cast<int16_t>(spawn_pos.y * CELL_SIZE));
+    p.x_vel = F4_ZERO;
+    p.y_vel = F4_ZERO;
+  }
+
+  // integrate velocity
+  p.x += p.x_vel;
+  p.y += p.y_vel;
+
+  // handle collisions against solid tiles
+  const int xn_low = p.x.to_integer_floor();
+  const int yn_low = p.y.to_integer_floor();
+
+  const int xn_tile_left = get_tile_id(xn_low);
+  const int xn_tile_right = get_tile_id(xn_low + PLAYER_WIDTH - 1);
+  const int yn_tile_down = get_tile_id(yn_low);
+  const int yn_tile_up = get_tile_id(yn_low + PLAYER_HEIGHT - 1);
+
+  // handle left right collisions
+  if (p.x_vel < F4_ZERO) {
+    // going left. check left side
+    if (collision.test(CollisionMap::SOLID, xn_tile_left, t.y_tile_down) ||
+        collision.test(CollisionMap::SOLID, xn_tile_left, t.y_tile_up)) {
+      // make flush with wall
+      p.x = F4(static_cast<int16_t>((xn_tile_left + 1) * CELL_SIZE));
+      // cancel velocity
+      p.x_vel = F4_ZERO;
+    }
+  } else if (p.x_vel > F4_ZERO) {
+    // going right. check right side
+    if (collision.test(CollisionMap::SOLID, xn_tile_right, t.y_tile_down) ||
+        collision.test(CollisionMap::SOLID, xn_tile_right, t.y_tile_up)) {
+      // make flush with wall
+      p.x = F4(static_cast<int16_t>(xn_tile_right * CELL_SIZE - PLAYER_WIDTH));
+      // cancel velocity
+      p.x_vel = F4_ZERO;
+    }
+  }
+  if (p.y_vel < F4_ZERO) {
+    // going down. check bottom
+    if (collision.test_any(CollisionMap::SOLID, t.x_tile_left, t.x_tile_right, yn_tile_down)) {
+      // make flush with floor
+      p.y = F4(static_cast<int16_t>((yn_tile_down + 1) * CELL_SIZE));
+      // cancel velocity
+      p.y_vel = F4_ZERO;
+    }
+  } else if (p.y_vel > F4_ZERO) {
+    // going up. check top
+    if (collision.test_any(CollisionMap::SOLID, t.x_tile_left, t.x_tile_right, yn_tile_up)) {
+      p.y = F4(static_cast<int16_t>(yn_tile_up * CELL_SIZE - PLAYER_HEIGHT));
+      // cancel velocity
+      p.y_vel = F4_ZERO;
+    }
+  }
+
+  // check coin collision.
+  // can do this in here (which would be both players in parallel in FPGA) because
+  // in the edge case where both players collide with the coin on the same frame,
+  // we'll just give both of them the point.
+  const int x_center = p.x.to_integer_rounded() + PLAYER_WIDTH / 2;
+  const int y_center = p.y.to_integer_rounded() + PLAYER_HEIGHT / 2;
+  const int x_tile_center = get_tile_id(x_center);
+  const int y_tile_center = get_tile_id(y_center);
+  const bool coin_collected = x_tile_center == coin_pos.x && y_tile_center == coin_pos.y;
+  if (coin_collected) {
+    // get a point for collecting coin
+    p.score += POINTS_PER_COIN;
+  }
+
+  // if death was queued, die
+  if (p.queue_dead) {
+    p.queue_dead = false;
+    p.dead_timeout = DEAD_TIMEOUT;
+  }
+  return coin_collected;
+}
+
+// advance both players (and the coin) by one frame. does not touch the game age.
+// collision must be built from map.
+constexpr void update_players(const TileMap &map, const CollisionMap &collision,
+                              GameRng &rng, TilePos &coin_pos, Player &p1, Player &p2,
+                              const PlayerInput &in1, const PlayerInput &in2) {
+  // updating can happen in parallel in FPGA.
+  // both players sample their surroundings before either one moves.
+  const PlayerTiles t1 = sample_player_tiles(p1, collision);
+  const PlayerTiles t2 = sample_player_tiles(p2, collision);
+
+  // these can be concurrent on FPGA
+  player_phase_1(p1, p2, t1, in1);
+  player_phase_1(p2, p1, t2, in2);
+  // the rng steps once per frame (during PHASE1_S on the PL), and each spawn tile
+  // comes from its own stream
+  rng.advance();
+  const TilePos p1_spawn = sample_spawn(map, rng.result(RNG_STREAM_P1));
+  const TilePos p2_spawn = sample_spawn(map, rng.result(RNG_STREAM_P2));
+
+  const bool p1_coin_collected = player_phase_2(p1, t1, collision, coin_pos, p1_spawn);
+  const bool p2_coin_collected = player_phase_2(p2, t2, collision, coin_pos, p2_spawn);
+
+  // some other ideas: maybe the player could place a temporary ground tile
+  // beneath them, at the expense of one point (the coin reward would have to
+  // be much higher, so that its still worth placing ground tiles if it means
+  // increased likelyhood of getting the coin)
+
+  // if the coin was collected,
+  // pick a new location from the valid coin spawn locations randomly.
+  // this must happen on a new cycle, so the number of cycles on fpga is phase count + 1
+  if (p1_coin_collected || p2_coin_collected) {
+    coin_pos = sample_spawn(map, rng.result(RNG_STREAM_COIN));
+  }
+}
+
+// advance a whole game by one frame
+constexpr void step(const MapData &map, GameState &state, PlayerInput in1, PlayerInput in2) {
+  update_players(map.tile_map, map.collision, state.rng, state.coin_pos, state.p1, state.p2, in1,
+                 in2);
+  ++state.age;
+}
+
+} // namespace jnb
@@ -0,0 +1,385 @@
+#include "gemv.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+// same approach as games/jnb_simd.cpp: one `#pragma omp simd` kernel, compiled again with
+// target attributes on gcc/clang x86 and picked at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GEMV_X86 1
+#define GEMV_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define GEMV_X86 0
+#define GEMV_ALWAYS_INLINE inline
+#endif
+
+// the row and partial sum loops must be unrolled for the sums to live in registers
+#if defined(__GNUC__)
+#define GEMV_UNROLL _Pragma("GCC unroll 8")
+#define GEMV_ASSUME_ALIGNED(p) static_cast<const float *>(__builtin_assume_aligned(p, 64))
+#else
+#define GEMV_UNROLL
+#define GEMV_ASSUME_ALIGNED(p) (p)
+#endif
+
+namespace model::gemv {
+
+namespace {
+
+// independent sums per output, over every PARTIALS-th input. a single chain of dependent adds
+// would leave the kernel waiting on add latency instead of throughput.
+constexpr int PARTIALS = 4;
+
+// ROWS inputs through the same net. every weight chunk is loaded once and used for all rows.
+// rows are summed the same way whatever ROWS is, so results don't depend on the blocking.
+template <int ROWS>
+GEMV_ALWAYS_INLINE void forward_rows(const float *weights, const float *bias, int inputs,
+                                     int outputs, int stride, const float *const *input,
+                                     float *const *output, bool activate) {
+  for (int o = 0; o < outputs; o += LANES) {
+    // one chunk of outputs per row stays in registers while every input is added in
+    float sum[ROWS][PARTIALS][LANES];
+    const float *b = GEMV_ASSUME_ALIGNED(bias + o);
+    GEMV_UNROLL
+    for (int r = 0; r < ROWS; ++r) {
+      GEMV_UNROLL
+      for (int p = 0; p < PARTIALS; ++p) {
+#pragma omp simd
+        for (int k = 0; k < LANES; ++k) {
+          sum[r][p][k] = p == 0 ? b[k] : 0.0f;
+        }
+      }
+    }
+
+    const int blocked = inputs / PARTIALS * PARTIALS;
+    for (int j = 0; j < blocked; j += PARTIALS) {
+      GEMV_UNROLL
+      for (int p = 0; p < PARTIALS; ++p) {
+        const float *w = GEMV_ASSUME_ALIGNED(weights + (j + p) * stride + o);
+        GEMV_UNROLL
+        for (int r = 0; r < ROWS; ++r) {
+          const float x = input[r][j + p];
+#pragma omp simd
+          for (int k = 0; k < LANES; ++k) {
+            sum[r][p][k] += w[k] * x;
+          }
+        }
+      }
+    }
+    for (int j = blocked; j < inputs; ++j) {
+      const float *w = GEMV_ASSUME_ALIGNED(weights + j * stride + o);
+      GEMV_UNROLL
+      for (int r = 0; r < ROWS; ++r) {
+        const float x = input[r][j];
+#pragma omp simd
+        for (int k = 0; k < LANES; ++k) {
+          sum[r][0][k] += w[k] * x;
+        }
+      }
+    }
+
+    // ReLU is a max against 0, or against -inf to leave the sums alone
+    const float floor = activate ? 0.0f : -std::numeric_limits<float>::infinity();
+    const int count = std::min(LANES, outputs - o);
+    GEMV_UNROLL
+    for (int r = 0; r < ROWS; ++r) {
+      float *out = output[r] + o;
+      if (count == LANES) {
+#pragma omp simd
+        for (int k = 0; k < LANES; ++k) {
+          out[k] = std::max(floor, (sum[r][0][k] + sum[r][1][k]) + (sum[r][2][k] + sum[r][3][k]));
+        }
+      } else {
+        for (int k = 0; k < count; ++k) {
+          out[k] = std::max(floor, (sum[r][0][k] + sum[r][1][k]) + (sum[r][2][k] + sum[r][3][k]));
+        }
+      }
+    }
+  }
+}
+
+GEMV_ALWAYS_INLINE void forward_impl(const float *weights, const float *bias, int inputs,
+                                     int outputs, int stride, const float *input, float *output,
+                                     bool activate) {
+  forward_rows<1>(weights, bias, inputs, outputs, stride, &input, &output, activate);
+}
+
+// how many rows of one net share the weight loads. with PARTIALS that is 8 independent sums,
+// enough to keep the fma units busy.
+constexpr int BLOCK_ROWS = 2;
+
+GEMV_ALWAYS_INLINE void forward_batch_impl(const StackedLayer &layer, const uint32_t *nets,
+                                           const uint32_t *order, size_t count,
+                                           const float *input, size_t input_stride,
+                                           float *output, size_t output_stride, bool activate) {
+  size_t i = 0;
+  while (i < count) {
+    // the run of rows that use this net
+    const uint32_t net = nets[order[i]];
+    size_t end = i + 1;
+    while (end < count && nets[order[end]] == net) {
+      ++end;
+    }
+    const float *weights = layer.weights + net * layer.net_stride;
+    const float *bias = layer.bias + net * layer.net_stride;
+
+    for (; i + BLOCK_ROWS <= end; i += BLOCK_ROWS) {
+      const float *in[BLOCK_ROWS];
+      float *out[BLOCK_ROWS];
+      for (int r = 0; r < BLOCK_ROWS; ++r) {
+        in[r] = input + order[i + r] * input_stride;
+        out[r] = output + order[i + r] * output_stride;
+      }
+      forward_rows<BLOCK_ROWS>(weights, bias, layer.inputs, layer.outputs, layer.stride, in, out,
+                               activate);
+    }
+    for (; i < end; ++i) {
+      forward_impl(weights, bias, layer.inputs, layer.outputs, layer.stride,
+                   input + order[i] * input_stride, output + order[i] * output_stride, activate);
+    }
+  }
+}
+
+void forward_generic(const float *weights, const float *bias, int inputs, int outputs,
+                     int stride, const float *input, float *output, bool activate) {
+  forward_impl(weights, bias, inputs, outputs, stride, input, output, activate);
+}
+
+void forward_batch_generic(const StackedLayer &layer, const uint32_t *nets,
+                           const uint32_t *order, size_t count, const float *input,
+                           size_t input_stride, float *output, size_t output_stride,
+                           bool activate) {
+  forward_batch_impl(layer, nets, order, count, input, input_stride, output, output_stride,
+                     activate);
+}
+
+#if GEMV_X86
+__attribute__((target("avx2,fma"))) void forward_avx2(const float *weights, const float *bias,
+                                                      int inputs, int outputs, int stride,
+                                                      const float *input, float *output,
+                                                      bool activate) {
+  forward_impl(weights, bias, inputs, outputs, stride, input, output, activate);
+}
+
+__attribute__((target("avx512f"))) void forward_avx512(const float *weights, const float *bias,
+                                                       int inputs, int outputs, int stride,
+                                                       const float *input, float *output,
+                                                       bool activate) {
+  forward_impl(weights, bias, inputs, outputs, stride, input, output, activate);
+}
+
+__attribute__((target("avx2,fma"))) void
+forward_batch_avx2(const StackedLayer &layer, const uint32_t *nets, const uint32_t *order,
+                   size_t count, const float *input, size_t input_stride, float *output,
+                   size_t output_stride, bool activate) {
+  forward_batch_impl(layer, nets, order, count, input, input_stride, output, output_stride,
+                     activate);
+}
+
+__attribute__((target("avx512f"))) void
+forward_batch_avx512(const StackedLayer &layer, const uint32_t *nets, const uint32_t *order,
+                     size_t count, const float *input, size_t input_stride, float *output,
+                     size_t output_stride, bool activate) {
+  forward_batch_impl(layer, nets, order, count, input, input_stride, output, output_stride,
+                     activate);
+}
+#endif
+
+constexpr int padded(int count) {
+  return (count + LANES - 1) / LANES * LANES;
+}
+
+// a whole net through forward_rows, with the arena layout of DynamicNeuralNet. once inlined every
+// size is a constant, so the chunk and input loops have fixed trip counts and no remainders.
+template <int ROWS, int INPUTS, int HIDDEN, int HIDDEN_COUNT, int OUTPUTS>
+GEMV_ALWAYS_INLINE void forward_net_impl(const float *params, const float *const *input,
+                                         float *const *output) {
+  constexpr int HIDDEN_STRIDE = padded(HIDDEN);
+  constexpr int OUTPUT_STRIDE = padded(OUTPUTS);
+  alignas(64) float buffers[2][ROWS][HIDDEN_STRIDE];
+  float *current[ROWS];
+  float *next[ROWS];
+  for (int r = 0; r < ROWS; ++r) {
+    current[r] = buffers[0][r];
+    next[r] = buffers[1][r];
+  }
+
+  const float *layer = params;
+  forward_rows<ROWS>(layer, layer + INPUTS * HIDDEN_STRIDE, INPUTS, HIDDEN, HIDDEN_STRIDE, input,
+                     current, true);
+  layer += (INPUTS + 1) * HIDDEN_STRIDE;
+  for (int i = 1; i < HIDDEN_COUNT; ++i) {
+    forward_rows<ROWS>(layer, layer + HIDDEN * HIDDEN_STRIDE, HIDDEN, HIDDEN, HIDDEN_STRIDE,
+                       current, next, true);
+    std::swap(current, next);
+    layer += (HIDDEN + 1) * HIDDEN_STRIDE;
+  }
+  forward_rows<ROWS>(layer, layer + HIDDEN * OUTPUT_STRIDE, HIDDEN, OUTPUTS, OUTPUT_STRIDE,
+                     current, output, false);
+}
+
+template <int... SHAPE>
+void forward_net_generic(const float *params, const float *input, float *output) {
+  forward_net_impl<1, SHAPE...>(params, &input, &output);
+}
+
+template <int... SHAPE>
+void forward_net_block_generic(const float *params, const float *const *input,
+                               float *const *output) {
+  forward_net_impl<NET_BLOCK_ROWS, SHAPE...>(params, input, output);
+}
+
+#if GEMV_X86
+template <int... SHAPE>
+__attribute__((target("avx2,fma"))) void forward_net_avx2(const float *params,
+                                                          const float *input, float *output) {
+  forward_net_impl<1, SHAPE...>(params, &input, &output);
+}
+
+template <int... SHAPE>
+__attribute__((target("avx512f"))) void forward_net_avx512(const float *params,
+                                                           const float *input, float *output) {
+  forward_net_impl<1, SHAPE...>(params, &input, &output);
+}
+
+template <int... SHAPE>
+__attribute__((target("avx2,fma"))) void forward_net_block_avx2(const float *params,
+                                                                const float *const *input,
+                                                                float *const *output) {
+  forward_net_impl<NET_BLOCK_ROWS, SHAPE...>(params, input, output);
+}
+
+template <int... SHAPE>
+__attribute__((target("avx512f"))) void forward_net_block_avx512(const float *params,
+                                                                 const float *const *input,
+                                                                 float *const *output) {
+  forward_net_impl<NET_BLOCK_ROWS, SHAPE...>(params, input, output);
+}
+#endif
+
+struct NetKernel {
+  int inputs;
+  int hidden_size;
+  int hidden_count;
+  int outputs;
+  NetForward generic;
+  NetForward avx2;
+  NetForward avx512;
+  NetForwardBlock block_generic;
+  NetForwardBlock block_avx2;
+  NetForwardBlock block_avx512;
+};
+
+template <int INPUTS, int HIDDEN, int HIDDEN_COUNT, int OUTPUTS>
+constexpr NetKernel net_kernel() {
+  static_assert(HIDDEN_COUNT >= 1, "nets have at least one hidden layer");
+#if GEMV_X86
+  return {INPUTS,
+          HIDDEN,
+          HIDDEN_COUNT,
+          OUTPUTS,
+          forward_net_generic<INPUTS, HIDDEN, HIDDEN_COUNT, OUTPUTS>,
+          forward_net_avx2<INPUTS, HIDDEN, HIDDEN_COUNT, OUTPUTS>,
+          forward_net_avx512<INPUTS, HIDDEN, HIDDEN_COUNT, OUTPUTS>,
+          forward_net_block_generic<INPUTS, HIDDEN, HIDDEN_COUNT, OUTPUTS>,
+          forward_net_block_avx2<INPUTS, HIDDEN, HIDDEN_COUNT, OUTPUTS>,
+          forward_net_block_avx512<INPUTS, HIDDEN, HIDDEN_COUNT, OUTPUTS>};
+#else
+  constexpr NetForward generic = forward_net_generic<INPUTS, HIDDEN, HIDDEN_COUNT, OUTPUTS>;
+  constexpr NetForwardBlock block =
+      forward_net_block_generic<INPUTS, HIDDEN, HIDDEN_COUNT, OUTPUTS>;
+  return {INPUTS, HIDDEN, HIDDEN_COUNT, OUTPUTS, generic, generic, generic, block, block, block};
+#endif
+}
+
+// shapes with a compiled forward: the simple JnB observation (12 values) to its 3 actions, at the
+// widths and depths SimpleMLP is trained with. any other shape runs layer by layer.
+constexpr NetKernel NET_KERNELS[] = {
+    net_kernel<12, 16, 2, 3>(), net_kernel<12, 16, 3, 3>(), net_kernel<12, 32, 2, 3>(),
+    net_kernel<12, 32, 3, 3>(), net_kernel<12, 64, 2, 3>(), net_kernel<12, 64, 3, 3>(),
+};
+
+} // namespace
+
+// SCALAR runs the same kernel compiled for the baseline target
+void forward(cpu::Isa isa, const float *weights, const float *bias, int inputs, int outputs,
+             int stride, const float *input, float *output, bool activate) {
+  switch (isa) {
+#if GEMV_X86
+    case cpu::Isa::AVX512:
+      forward_avx512(weights, bias, inputs, outputs, stride, input, output, activate);
+      break;
+    case cpu::Isa::AVX2:
+      forward_avx2(weights, bias, inputs, outputs, stride, input, output, activate);
+      break;
+#endif
+    default:
+      forward_generic(weights, bias, inputs, outputs, stride, input, output, activate);
+      break;
+  }
+}
+
+void forward_batch(cpu::Isa isa, const StackedLayer &layer, const uint32_t *nets,
+                   const uint32_t *order, size_t count, const float *input, size_t input_stride,
+                   float *output, size_t output_stride, bool activate) {
+  switch (isa) {
+#if GEMV_X86
+    case cpu::Isa::AVX512:
+      forward_batch_avx512(layer, nets, order, count, input, input_stride, output,
+                           output_stride, activate);
+      break;
+    case cpu::Isa::AVX2:
+      forward_batch_avx2(layer, nets, order, count, input, input_stride, output, output_stride,
+                         activate);
+      break;
+#endif
+    default:
+      forward_batch_generic(layer, nets, order, count, input, input_stride, output,
+                            output_stride, activate);
+      break;
+  }
+}
+
+NetForward find_net_forward(cpu::Isa isa, int inputs, int hidden_size, int hidden_count,
+                            int outputs) {
+  for (const auto &kernel : NET_KERNELS) {
+    if (kernel.inputs == inputs && kernel.hidden_size == hidden_size &&
+        kernel.hidden_count == hidden_count && kernel.outputs == outputs) {
+      switch (isa) {
+        case cpu::Isa::AVX512:
+          return kernel.avx512;
+        case cpu::Isa::AVX2:
+          return kernel.avx2;
+        default:
+          return kernel.generic;
+      }
+    }
+  }
+  return nullptr;
+}
+
+NetForwardBlock find_net_forward_block(cpu::Isa isa, int inputs, int hidden_size,
+                                       int hidden_count, int outputs) {
+  for (const auto &kernel : NET_KERNELS) {
+    if (kernel.inputs == inputs && kernel.hidden_size == hidden_size &&
+        kernel.hidden_count == hidden_count && kernel.outputs == outputs) {
+      switch (isa) {
+        case cpu::Isa::AVX512:
+          return kernel.block_avx512;
+        case cpu::Isa::AVX2:
+          return kernel.block_avx2;
+        default:
+          return kernel.block_generic;
+      }
+    }
+  }
+  return nullptr;
+}
+
+cpu::Isa get_isa() {
+  static const cpu::Isa isa = cpu::detect_isa();
+  return isa;
+}
+
+} // namespace model::gemv
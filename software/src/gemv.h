@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cpu_isa.h"
+
+// dense layer kernels for DynamicLayer<float>. weights are input-major with each input's row of
+// output weights padded to `stride` floats, so a row is whole cache lines and the kernels
+// vectorize across outputs with aligned loads and no horizontal sums.
+namespace model::gemv {
+
+// floats per kernel chunk, one AVX-512 register or two AVX2 ones
+constexpr int LANES = 16;
+
+// output[o] = bias[o] + sum_j weights[j * stride + o] * input[j], with ReLU when activate.
+// stride must be a multiple of LANES, weights and bias 64-byte aligned and bias padded to
+// stride. output must not overlap input, only its first `outputs` values are written. inputs are
+// summed in interleaved partial sums, so results differ from a plain loop by rounding only.
+void forward(cpu::Isa isa, const float *weights, const float *bias, int inputs, int outputs,
+             int stride, const float *input, float *output, bool activate);
+
+// one layer of many same-shape nets stacked in one buffer, net n's parameters are
+// net_stride floats after net n - 1's. layout per net as for forward.
+struct StackedLayer {
+  const float *weights; // net 0
+  const float *bias;    // net 0
+  size_t net_stride;    // multiple of LANES
+  int inputs;
+  int outputs;
+  int stride;
+};
+
+// forward for many rows in one call. order lists the `count` rows to run, with the rows of one
+// net next to each other so its weights are loaded once per block of rows. row i goes through
+// net nets[i], inputs and outputs are rows input_stride and output_stride floats apart. results
+// are identical to forward on each row.
+void forward_batch(cpu::Isa isa, const StackedLayer &layer, const uint32_t *nets,
+                   const uint32_t *order, size_t count, const float *input, size_t input_stride,
+                   float *output, size_t output_stride, bool activate);
+
+// a whole DynamicNeuralNet<float> forward for one shape, with every size a compile-time
+// constant. params is the net's arena, each layer's weights then its bias, rows padded to whole
+// chunks.
+using NetForward = void (*)(const float *params, const float *input, float *output);
+
+// the compiled forward for a shape in DynamicNeuralNet::init terms, or nullptr when the shape is
+// not in the kernel table. results are identical to running forward layer by layer.
+NetForward find_net_forward(cpu::Isa isa, int inputs, int hidden_size, int hidden_count,
+                            int outputs);
+
+// rows per call of a NetForwardBlock
+constexpr int NET_BLOCK_ROWS = 4;
+
+// NetForward for NET_BLOCK_ROWS rows through the same net, so each weight chunk is loaded once
+// for all of them. results are identical to NetForward on each row.
+using NetForwardBlock = void (*)(const float *params, const float *const *inputs,
+                                 float *const *outputs);
+
+// the compiled block forward for a shape, nullptr exactly when find_net_forward has none
+NetForwardBlock find_net_forward_block(cpu::Isa isa, int inputs, int hidden_size,
+                                       int hidden_count, int outputs);
+
+// detect_isa() once per process
+cpu::Isa get_isa();
+
+} // namespace model::gemv
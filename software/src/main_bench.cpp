@@ -0,0 +1,782 @@
+// headless throughput benchmarks for the game engines
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "games/jnb.h"
+#include "games/jnb_batch.h"
+#include "games/jnb_obs_image.h"
+#include "games/jnb_replay.h"
+#include "games/jnb_simd.h"
+#include "games/jnb_step.h"
+#include "models/mlp_simple.h"
+#include "models/mlp_stack.h"
+#include "optimizers/ga.h"
+#include "optimizers/ga_funs.h"
+#include "optimizers/ga_jnb.h"
+#include "mutation.h"
+#include "pl_hw_nn.h"
+#include "pl_nn.h"
+
+using namespace jnb;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// random packed inputs for every player of every game, a few frames worth that get cycled
+std::vector<std::vector<uint8_t>> make_action_frames(size_t games, size_t count, uint64_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> dist(0, 7);
+  std::vector<std::vector<uint8_t>> frames(count);
+  for (auto &frame : frames) {
+    frame.resize(games * 2);
+    for (auto &bits : frame) {
+      bits = static_cast<uint8_t>(dist(rng));
+    }
+  }
+  return frames;
+}
+
+bool same_state(const JnBBatch &a, const JnBBatch &b) {
+  for (int p = 0; p < 2; ++p) {
+    const auto &pa = a.players[p];
+    const auto &pb = b.players[p];
+    if (pa.x != pb.x || pa.y != pb.y || pa.x_vel != pb.x_vel || pa.y_vel != pb.y_vel ||
+        pa.score != pb.score || pa.dead_timeout != pb.dead_timeout ||
+        pa.queue_dead != pb.queue_dead) {
+      return false;
+    }
+  }
+  return a.coin_x == b.coin_x && a.coin_y == b.coin_y && a.age == b.age &&
+         a.get_episode_fitness() == b.get_episode_fitness();
+}
+
+void bench_single(const std::string &map_file, int frames) {
+  JnBGame game(map_file, -1);
+  game.init(0);
+  const auto action_frames = make_action_frames(1, 64, 1);
+  std::vector<std::vector<float>> actions(2, std::vector<float>(3));
+
+  auto start = Clock::now();
+  for (int f = 0; f < frames; ++f) {
+    const auto &frame = action_frames[f % action_frames.size()];
+    for (int p = 0; p < 2; ++p) {
+      const auto input = unpack_input(frame[p]);
+      actions[p][0] = input.left;
+      actions[p][1] = input.right;
+      actions[p][2] = input.jump;
+    }
+    game.update(actions);
+  }
+  const double elapsed = seconds_since(start);
+  std::cout << "JnBGame::update: " << frames / elapsed << " frames/sec" << std::endl;
+}
+
+// bare per-frame cost of the shared step core, without action discretization
+void bench_step(const std::string &map_file, int frames) {
+  JnBGame game(map_file, -1);
+  game.init(0);
+  const auto action_frames = make_action_frames(1, 64, 1);
+
+  const MapData &map = *game.get_map();
+  GameState state = game.state;
+  auto start = Clock::now();
+  for (int f = 0; f < frames; ++f) {
+    const auto &frame = action_frames[f % action_frames.size()];
+    step(map, state, unpack_input(frame[0]), unpack_input(frame[1]));
+  }
+  const double elapsed = seconds_since(start);
+  std::cout << "step: " << elapsed / frames * 1e9 << " ns/frame (score " << state.p1.score
+            << " - " << state.p2.score << ")" << std::endl;
+}
+
+// cost of branching a game: full clone vs snapshot/restore into a reused buffer
+void bench_snapshot(const std::string &map_file, int count) {
+  JnBGame game(map_file, -1);
+  game.init(0);
+
+  auto start = Clock::now();
+  for (int i = 0; i < count; ++i) {
+    auto clone = game.clone();
+  }
+  const double clone_elapsed = seconds_since(start);
+
+  std::vector<uint8_t> buffer;
+  start = Clock::now();
+  for (int i = 0; i < count; ++i) {
+    game.snapshot(buffer);
+    game.restore(buffer);
+  }
+  const double snapshot_elapsed = seconds_since(start);
+
+  std::cout << "clone: " << clone_elapsed / count * 1e9 << " ns, snapshot + restore: "
+            << snapshot_elapsed / count * 1e9 << " ns (" << buffer.size() << " bytes)"
+            << std::endl;
+}
+
+bool same_player(const Player &a, const Player &b) {
+  return a.x == b.x && a.y == b.y && a.x_vel == b.x_vel && a.y_vel == b.y_vel &&
+         a.score == b.score && a.dead_timeout == b.dead_timeout && a.queue_dead == b.queue_dead;
+}
+
+bool same_game_state(const GameState &a, const GameState &b) {
+  return same_player(a.p1, b.p1) && same_player(a.p2, b.p2) && a.coin_pos.x == b.coin_pos.x &&
+         a.coin_pos.y == b.coin_pos.y && a.age == b.age;
+}
+
+// record -> write -> open -> seek round trips, including episodes that end exactly on a
+// keyframe interval, and the cost of a seek
+void bench_replay(const std::string &map_file, int seeks) {
+  const auto action_frames = make_action_frames(1, 64, 3);
+  const std::string filename =
+      (std::filesystem::temp_directory_path() / "jnb_bench_replay.jnbr").string();
+  bool matches = true;
+  double seek_elapsed = 0.0;
+  int seek_count = 0;
+
+  for (uint32_t frame_count : {255u, 256u, 400u, 512u}) {
+    JnBGame game(map_file, -1);
+    game.init(frame_count);
+    const auto map = game.get_map();
+    GameState state = game.state;
+    ReplayWriter writer(map->hash, frame_count, state);
+    std::vector<GameState> states{state};
+    for (uint32_t f = 0; f < frame_count; ++f) {
+      const auto &frame = action_frames[f % action_frames.size()];
+      writer.record(state, unpack_input(frame[0]), unpack_input(frame[1]));
+      step(*map, state, unpack_input(frame[0]), unpack_input(frame[1]));
+      states.push_back(state);
+    }
+
+    ReplayReader reader;
+    if (!writer.write(filename) || !reader.open(filename)) {
+      matches = false;
+      continue;
+    }
+    GameState seeked;
+    for (uint32_t frame : {0u, frame_count / 2, frame_count - 1, frame_count}) {
+      matches = matches && reader.seek(*map, frame, seeked) &&
+                same_game_state(seeked, states[frame]);
+    }
+    matches = matches && !reader.seek(*map, frame_count + 1, seeked);
+
+    auto start = Clock::now();
+    for (int i = 0; i < seeks; ++i) {
+      reader.seek(*map, frame_count - i % frame_count, seeked);
+    }
+    seek_elapsed += seconds_since(start);
+    seek_count += seeks;
+  }
+  std::filesystem::remove(filename);
+
+  std::cout << "ReplayReader::seek: " << seek_elapsed / seek_count * 1e9 << " ns"
+            << (matches ? " (matches)" : " (MISMATCH)") << std::endl;
+}
+
+void bench_batch(std::shared_ptr<const MapData> map, size_t games, int steps) {
+  constexpr int FRAME_LIMIT = 400;
+  std::vector<uint64_t> seeds(games * (steps / FRAME_LIMIT + 1));
+  for (size_t i = 0; i < seeds.size(); ++i) {
+    seeds[i] = i;
+  }
+  const auto action_frames = make_action_frames(games, 64, 2);
+
+  auto run = [&](simd::Isa isa, JnBBatch &batch) {
+    batch.set_isa(isa);
+    batch.reset(seeds);
+    auto start = Clock::now();
+    for (int s = 0; s < steps; ++s) {
+      batch.step(action_frames[s % action_frames.size()]);
+    }
+    const double rate = static_cast<double>(games) * steps / seconds_since(start);
+    std::cout << "JnBBatch (" << simd::isa_name(isa) << ", " << games << " games): " << rate
+              << " frames/sec";
+    return rate;
+  };
+
+  // the same games stepped one at a time through step(), which is what JnBGame::update runs.
+  // the scalar kernel is checked against it on games that never reset.
+  JnBBatch unlimited(map, games, -1);
+  unlimited.set_isa(simd::Isa::SCALAR);
+  unlimited.reset(seeds);
+  std::vector<GameState> states(games);
+  for (size_t i = 0; i < games; ++i) {
+    unlimited.load(i, states[i]);
+  }
+  auto start = Clock::now();
+  for (int s = 0; s < steps; ++s) {
+    const auto &frame = action_frames[s % action_frames.size()];
+    for (size_t i = 0; i < games; ++i) {
+      step(*map, states[i], unpack_input(frame[i]), unpack_input(frame[games + i]));
+    }
+  }
+  const double step_rate = static_cast<double>(games) * steps / seconds_since(start);
+  std::cout << "step (" << games << " games): " << step_rate << " frames/sec" << std::endl;
+
+  bool matches = true;
+  for (int s = 0; s < steps; ++s) {
+    unlimited.step(action_frames[s % action_frames.size()]);
+  }
+  for (size_t i = 0; i < games; ++i) {
+    GameState state;
+    unlimited.load(i, state);
+    matches &= same_game_state(state, states[i]);
+  }
+
+  JnBBatch reference(map, games, FRAME_LIMIT);
+  const double scalar_rate = run(simd::Isa::SCALAR, reference);
+  std::cout << ", " << scalar_rate / step_rate << "x step"
+            << (matches ? " (matches step)" : " (MISMATCH)") << std::endl;
+
+  const auto best = simd::detect_isa();
+  if (best == simd::Isa::SCALAR) {
+    std::cout << "JnBBatch: no wide kernel for this cpu or build" << std::endl;
+  }
+  for (auto isa : {simd::Isa::AVX2, simd::Isa::AVX512}) {
+    if (static_cast<int>(isa) > static_cast<int>(best)) {
+      continue;
+    }
+    JnBBatch batch(map, games, FRAME_LIMIT);
+    const double rate = run(isa, batch);
+    std::cout << ", " << rate / scalar_rate << "x scalar"
+              << (same_state(reference, batch) ? " (matches scalar)" : " (MISMATCH)")
+              << std::endl;
+  }
+}
+
+// per-game JnBGame::observe into separate vectors vs one JnBBatch::observe into a flat buffer
+void bench_observe(std::shared_ptr<const MapData> map, const std::string &map_file, size_t games,
+                   int steps) {
+  JnBBatch batch(map, games, -1);
+  std::vector<uint64_t> seeds(games);
+  for (size_t i = 0; i < games; ++i) {
+    seeds[i] = i;
+  }
+  batch.reset(seeds);
+  const auto action_frames = make_action_frames(games, 16, 3);
+  for (const auto &frame : action_frames) {
+    batch.step(frame);
+  }
+
+  JnBGame game(map_file, -1);
+  std::vector<std::vector<obs::Simple>> per_game(games, game.build_observation());
+  auto start = Clock::now();
+  for (int s = 0; s < steps; ++s) {
+    for (size_t i = 0; i < games; ++i) {
+      batch.load(i, game.state);
+      game.observe(per_game[i]);
+    }
+  }
+  const double single_elapsed = seconds_since(start);
+
+  ObservationBatch flat;
+  start = Clock::now();
+  for (int s = 0; s < steps; ++s) {
+    batch.observe(flat);
+  }
+  const double batch_elapsed = seconds_since(start);
+
+  bool matches = true;
+  for (size_t i = 0; i < games; ++i) {
+    for (size_t p = 0; p < 2; ++p) {
+      const auto slice = flat.get(i, p);
+      matches = matches && std::equal(slice.begin(), slice.end(), per_game[i][p].begin());
+    }
+  }
+  const double count = static_cast<double>(games) * steps;
+  std::cout << "observe (" << games << " games): JnBGame " << single_elapsed / count * 1e9
+            << " ns/game (incl. load), JnBBatch " << batch_elapsed / count * 1e9 << " ns/game"
+            << (matches ? " (matches)" : " (MISMATCH)") << std::endl;
+}
+
+// JnBGame::render into a fresh buffer every frame vs into the same one with a render target,
+// where only what changed is redrawn
+void bench_render(const std::string &map_file, int frames) {
+  JnBGame game(map_file, -1);
+  game.init(0);
+  const auto action_frames = make_action_frames(1, 64, 5);
+  std::vector<std::vector<float>> actions(2, std::vector<float>(3));
+  const auto res = game.get_resolution();
+
+  // a new buffer of the right size every frame, which the allocator tends to put where the last
+  // one was, one reused buffer, and three buffers taken in turn like the TripleBuffer the
+  // spectator window renders into
+  for (size_t buffer_count : {0, 1, 3}) {
+    std::vector<std::vector<uint32_t>> buffers(std::max<size_t>(buffer_count, 1));
+    std::vector<rendering::RenderTarget> targets(buffers.size());
+    std::vector<uint32_t> fresh;
+    bool matches = true;
+    auto start = Clock::now();
+    for (int f = 0; f < frames; ++f) {
+      const auto &frame = action_frames[f % action_frames.size()];
+      for (int p = 0; p < 2; ++p) {
+        const auto input = unpack_input(frame[p]);
+        actions[p][0] = input.left;
+        actions[p][1] = input.right;
+        actions[p][2] = input.jump;
+      }
+      game.update(actions);
+      auto &pixels = buffers[f % buffers.size()];
+      if (buffer_count == 0) {
+        pixels = std::vector<uint32_t>(static_cast<size_t>(res.first) * res.second);
+        game.render(pixels);
+      } else {
+        game.render(pixels, targets[f % targets.size()]);
+      }
+      // now and then compare against a full redraw
+      if (f % 97 == 0) {
+        game.render(fresh);
+        matches = matches && fresh == pixels;
+      }
+    }
+    const double elapsed = seconds_since(start);
+    const char *name = buffer_count == 0 ? "new buffer" : buffer_count == 1 ? "same buffer"
+                                                                           : "3 buffers";
+    std::cout << "render (" << name << "): " << elapsed / frames * 1e9 << " ns/frame"
+              << (matches ? " (matches)" : " (MISMATCH)") << std::endl;
+  }
+}
+
+// per-frame cost of image observations at full and per-tile resolution
+void bench_image_observe(const std::string &map_file, int frames) {
+  JnBGame game(map_file, -1);
+  game.init(0);
+  const auto action_frames = make_action_frames(1, 64, 4);
+  const MapData &map = *game.get_map();
+
+  for (int cell_size : {1, CELL_SIZE}) {
+    const ImageObserver observer(map.tile_map, cell_size);
+    obs::Image image = observer.build_observation();
+    GameState state = game.state;
+    auto start = Clock::now();
+    for (int f = 0; f < frames; ++f) {
+      const auto &frame = action_frames[f % action_frames.size()];
+      step(map, state, unpack_input(frame[0]), unpack_input(frame[1]));
+      observer.observe(state, true, image);
+    }
+    const double elapsed = seconds_since(start);
+    const auto [w, h] = observer.get_resolution();
+    std::cout << "ImageObserver " << w << "x" << h << ": " << elapsed / frames * 1e9
+              << " ns/frame (incl. step)" << std::endl;
+  }
+}
+
+// selection and mutation of a GA generation. tournament copies share their parent's model until
+// they are mutated, so the evaluated parents must come out of step() unchanged, and every
+// mutated slot must end up with a model of its own.
+void bench_ga_step(int generations) {
+  const obs::Simple sample(12, 0.5f);
+  ga::Config<obs::Simple> config;
+  config.population_size = 64;
+  config.prior_best_size = 2;
+  config.references_size = 2;
+  config.populate_fun = ga::make_tournament<obs::Simple>(4);
+  config.prior_best_select = ga::make_tournament_prior_best<obs::Simple>(2);
+  config.model_builder = [&](std::mt19937 &rng) -> std::shared_ptr<model::Model<obs::Simple>> {
+    auto mlp = std::make_shared<model::SimpleMLP>(32, 3);
+    mlp->init(sample, 3, rng);
+    return mlp;
+  };
+  // cheap stand-in for playing episodes, all that matters is that selection has a ranking
+  config.fitness_fun = [&](ga::Solution<obs::Simple> &sol, auto &, auto &, const auto &) {
+    std::vector<float> action(3);
+    sol.model->forward(sample, action);
+    sol.fitness = static_cast<int>(action[0] * 1000.0f);
+  };
+
+  ga::State<obs::Simple> state;
+  ga::init(state, config);
+  bool matches = true;
+  double elapsed = 0.0;
+  for (int g = 0; g < generations; ++g) {
+    std::vector<uint64_t> evaluated;
+    for (const auto &sol : state.current) {
+      evaluated.push_back(sol.model->get_hash());
+    }
+    auto start = Clock::now();
+    ga::step(state, config);
+    elapsed += seconds_since(start);
+
+    // step swapped the evaluated generation into next
+    for (size_t i = 0; i < evaluated.size(); ++i) {
+      matches = matches && state.next[i].model->get_hash() == evaluated[i];
+    }
+    // every mutated slot owns a model that no other slot and no evaluated parent uses. slot 0
+    // is not mutated, so it may share with its parent.
+    std::vector<const model::Model<obs::Simple> *> mutated, parents, shared;
+    for (size_t i = 1; i < state.current.size(); ++i) {
+      mutated.push_back(state.current[i].model.get());
+    }
+    for (const auto &sol : state.next) {
+      parents.push_back(sol.model.get());
+    }
+    std::sort(mutated.begin(), mutated.end());
+    std::sort(parents.begin(), parents.end());
+    std::set_intersection(mutated.begin(), mutated.end(), parents.begin(), parents.end(),
+                          std::back_inserter(shared));
+    matches = matches && shared.empty() &&
+              std::adjacent_find(mutated.begin(), mutated.end()) == mutated.end();
+  }
+  std::cout << "GA step (" << config.population_size << " SimpleMLP(32, 3)): "
+            << elapsed / generations * 1e6 << " us/generation"
+            << (matches ? " (matches)" : " (MISMATCH)") << std::endl;
+}
+
+// the per-frame inference cost of the training model, and the per-child cost of making one
+void bench_mlp(int count) {
+  std::mt19937 rng(5);
+  const obs::Simple sample(12, 0.0f);
+  model::SimpleMLP mlp(32, 3);
+  mlp.init(sample, 3, rng);
+
+  std::vector<obs::Simple> observations(64, obs::Simple(12));
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &observation : observations) {
+    for (auto &value : observation) {
+      value = dist(rng);
+    }
+  }
+  std::vector<float> action(3);
+  float sink = 0.0f;
+
+  auto start = Clock::now();
+  for (int i = 0; i < count; ++i) {
+    mlp.forward(observations[i % observations.size()], action);
+    sink += action[0];
+  }
+  double elapsed = seconds_since(start);
+  std::cout << "SimpleMLP(32, 3) forward: " << elapsed / count * 1e9 << " ns (" << sink << ")"
+            << std::endl;
+
+  // the same net without its compiled shape kernel
+  start = Clock::now();
+  for (int i = 0; i < count; ++i) {
+    mlp.get_net().forward_layers(observations[i % observations.size()].data(), action.data());
+    sink += action[0];
+  }
+  elapsed = seconds_since(start);
+  std::cout << "SimpleMLP(32, 3) forward layer by layer: " << elapsed / count * 1e9 << " ns ("
+            << sink << ")" << std::endl;
+
+  const int children = count / 100;
+  start = Clock::now();
+  for (int i = 0; i < children; ++i) {
+    auto child = mlp.clone();
+    child->mutate(rng, 0.001f);
+  }
+  elapsed = seconds_since(start);
+  std::cout << "SimpleMLP(32, 3) clone + mutate: " << elapsed / children * 1e9 << " ns"
+            << std::endl;
+}
+
+// mutation::add_normal_rows on every kernel the cpu supports. the kernels must agree bit for
+// bit, since a genome's parameters are rebuilt from its seeds on whatever cpu loads it.
+void bench_add_normal(int count) {
+  constexpr size_t ROWS = 37, COLUMNS = 45, STRIDE = 48;
+  std::vector<float> start_values(ROWS * STRIDE);
+  std::mt19937 value_rng(7);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &value : start_values) {
+    value = dist(value_rng);
+  }
+
+  std::vector<float> expected;
+  const auto best = simd::detect_isa();
+  for (auto isa : {simd::Isa::SCALAR, simd::Isa::AVX2, simd::Isa::AVX512}) {
+    if (static_cast<int>(isa) > static_cast<int>(best)) {
+      continue;
+    }
+    std::vector<float> values = start_values;
+    std::mt19937 seed_rng(11);
+    auto start = Clock::now();
+    for (int i = 0; i < count; ++i) {
+      mutation::Rng rng(seed_rng);
+      mutation::add_normal_rows(isa, rng, values.data(), ROWS, COLUMNS, STRIDE, 0.01f);
+    }
+    const double elapsed = seconds_since(start);
+
+    std::cout << "add_normal_rows (" << simd::isa_name(isa) << ", " << ROWS * COLUMNS
+              << " values): " << elapsed / count * 1e9 << " ns";
+    if (expected.empty()) {
+      expected = values;
+      std::cout << std::endl;
+    } else {
+      // compared as bits, not values
+      const bool same = std::memcmp(values.data(), expected.data(),
+                                    values.size() * sizeof(float)) == 0;
+      std::cout << (same ? " (matches scalar)" : " (MISMATCH)") << std::endl;
+    }
+  }
+}
+
+// every gemv kernel the cpu supports on the SimpleMLP(32, 3) layer shapes, checked against
+// DynamicLayer::forward_scalar
+void bench_gemv(int count) {
+  std::mt19937 rng(6);
+  model::DynamicNeuralNet<float> net;
+  net.init(rng, 12, 32, 3, 3);
+  // 13 inputs is not a multiple of the kernel's partial sums, so its leftover inputs get checked
+  model::DynamicNeuralNet<float> odd;
+  odd.init(rng, 13, 32, 1, 3);
+  std::vector<const model::DynamicLayer<float> *> layers;
+  for (const auto &layer : net.layers) {
+    layers.push_back(&layer);
+  }
+  layers.push_back(&odd.layers[0]);
+
+  std::vector<float> input(32);
+  std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+  for (auto &value : input) {
+    value = dist(rng);
+  }
+  std::vector<float> expected(32), output(32);
+
+  const auto best = simd::detect_isa();
+  for (auto isa : {simd::Isa::SCALAR, simd::Isa::AVX2, simd::Isa::AVX512}) {
+    if (static_cast<int>(isa) > static_cast<int>(best)) {
+      continue;
+    }
+    for (const auto *layer : layers) {
+      layer->forward_scalar(input.data(), expected.data());
+      auto start = Clock::now();
+      for (int i = 0; i < count; ++i) {
+        model::gemv::forward(isa, layer->weights, layer->bias, layer->inputs, layer->outputs,
+                             layer->stride, input.data(), output.data(), true);
+      }
+      const double elapsed = seconds_since(start);
+
+      float error = 0.0f;
+      for (int o = 0; o < layer->outputs; ++o) {
+        error = std::max(error, std::abs(output[o] - expected[o]) / (1.0f + std::abs(expected[o])));
+      }
+      std::cout << "gemv (" << simd::isa_name(isa) << ", " << layer->inputs << "->"
+                << layer->outputs << "): " << elapsed / count * 1e9 << " ns"
+                << (error < 1e-5f ? " (matches scalar)" : " (MISMATCH)") << std::endl;
+    }
+  }
+}
+
+// one frame of population evaluation: every row of a batch through its own net, stacked vs
+// one DynamicNeuralNet::forward per row. rows are laid out like the batched fitness function
+// lays them out, a solution per 24 games against 6 opponents.
+void bench_stacked_mlp(size_t games, int frames) {
+  constexpr size_t SOLUTIONS = 64;
+  constexpr size_t OPPONENTS = 6;
+  std::mt19937 rng(7);
+  std::vector<model::DynamicNeuralNet<float>> nets(SOLUTIONS + OPPONENTS);
+  model::StackedMLP stack;
+  for (auto &net : nets) {
+    net.init(rng, SIMPLE_INPUT_COUNT, 32, 3, 3);
+    stack.add(net);
+  }
+
+  const size_t rows = games * 2;
+  std::vector<uint32_t> row_nets(rows);
+  for (size_t game = 0; game < games; ++game) {
+    row_nets[game * 2] = static_cast<uint32_t>(game / (OPPONENTS * 4) % SOLUTIONS);
+    row_nets[game * 2 + 1] = static_cast<uint32_t>(SOLUTIONS + game % OPPONENTS);
+  }
+  std::vector<float> inputs(rows * SIMPLE_INPUT_COUNT);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &value : inputs) {
+    value = dist(rng);
+  }
+  std::vector<float> stacked(rows * 3), single(rows * 3);
+
+  auto start = Clock::now();
+  for (int f = 0; f < frames; ++f) {
+    stack.forward(row_nets, inputs.data(), SIMPLE_INPUT_COUNT, stacked.data(), 3);
+  }
+  const double stacked_elapsed = seconds_since(start);
+
+  start = Clock::now();
+  for (int f = 0; f < frames; ++f) {
+    for (size_t row = 0; row < rows; ++row) {
+      nets[row_nets[row]].forward(&inputs[row * SIMPLE_INPUT_COUNT], &single[row * 3]);
+    }
+  }
+  const double single_elapsed = seconds_since(start);
+
+  const double per_row = 1e9 / (static_cast<double>(frames) * rows);
+  std::cout << "StackedMLP (" << rows << " rows): " << stacked_elapsed * per_row
+            << " ns/row, per net forward " << single_elapsed * per_row << " ns/row"
+            << (stacked == single ? " (matches)" : " (MISMATCH)") << std::endl;
+}
+
+// one generation of fitness evaluation the way training does it, batched with stacked nets,
+// against make_game_fitness_2p playing every episode on its own
+void bench_batched_fitness(const std::string &map_file, int frame_limit) {
+  auto game = std::make_shared<JnBGame>(map_file, frame_limit);
+  const auto sample = game->build_observation();
+  std::mt19937 rng(13);
+  auto make_model = [&]() -> std::shared_ptr<model::Model<obs::Simple>> {
+    auto mlp = std::make_shared<model::SimpleMLP>(32, 3);
+    mlp->init(sample[0], game->get_action_count(), rng);
+    return mlp;
+  };
+  ga::Population<obs::Simple> batched(64), single;
+  for (auto &sol : batched) {
+    sol.model = make_model();
+  }
+  single = batched;
+  std::vector<std::shared_ptr<model::Model<obs::Simple>>> refs{make_model(), make_model()};
+  std::vector<std::shared_ptr<model::Model<obs::Simple>>> prior_best{make_model(), make_model()};
+  const std::vector<uint64_t> seeds{1, 2};
+
+  auto population_fitness = ga::make_jnb_fitness_2p_batched(game->get_map(), frame_limit);
+  auto start = Clock::now();
+  population_fitness(batched, refs, prior_best, seeds);
+  const double batched_elapsed = seconds_since(start);
+
+  std::shared_ptr<Game<obs::Simple>> base = game;
+  auto fitness = ga::make_game_fitness_2p(base);
+  start = Clock::now();
+  for (auto &sol : single) {
+    fitness(sol, refs, prior_best, seeds);
+  }
+  const double single_elapsed = seconds_since(start);
+
+  bool matches = true;
+  for (size_t i = 0; i < single.size(); ++i) {
+    matches = matches && batched[i].fitness == single[i].fitness &&
+              batched[i].ref_fitness == single[i].ref_fitness &&
+              batched[i].prior_best_fitness == single[i].prior_best_fitness;
+  }
+  std::cout << "Batched fitness (" << batched.size() << " SimpleMLP(32, 3)): "
+            << batched_elapsed * 1e3 << " ms/generation, make_game_fitness_2p "
+            << single_elapsed * 1e3 << " ms/generation"
+            << (matches ? " (matches)" : " (MISMATCH)") << std::endl;
+}
+
+// one hidden layer of the PLNNModel net, int16 kernel vs the int reference path
+void bench_pl_layer(int count) {
+  std::mt19937 rng(8);
+  model::StaticPLLayer<32, 32> layer;
+  mutation::Rng init_rng(rng);
+  layer.init(init_rng);
+
+  // 12 bit activations, like the ones coming out of a previous layer
+  std::vector<int> inputs(64 * 32);
+  std::uniform_int_distribution<int> dist(-4095, 4095);
+  for (auto &value : inputs) {
+    value = dist(rng);
+  }
+  int output[32], expected[32];
+  bool matches = true;
+  int64_t sink = 0;
+
+  auto start = Clock::now();
+  for (int i = 0; i < count; ++i) {
+    layer.forward(&inputs[i % 64 * 32], output);
+    sink += output[0];
+  }
+  const double kernel_elapsed = seconds_since(start);
+
+  start = Clock::now();
+  for (int i = 0; i < count; ++i) {
+    layer.forward_scalar(&inputs[i % 64 * 32], expected);
+    sink -= expected[0];
+  }
+  const double scalar_elapsed = seconds_since(start);
+
+  for (int i = 0; i < 64; ++i) {
+    layer.forward(&inputs[i * 32], output);
+    layer.forward_scalar(&inputs[i * 32], expected);
+    matches &= std::equal(output, output + 32, expected);
+  }
+  std::cout << "StaticPLLayer<32, 32> forward: " << kernel_elapsed / count * 1e9
+            << " ns, scalar " << scalar_elapsed / count * 1e9 << " ns"
+            << (matches && sink == 0 ? " (matches)" : " (MISMATCH)") << std::endl;
+}
+
+// the PL hardware net emulator on random BRAM contents, BatchNet vs Net::forward per row
+void bench_pl_hw(int rows) {
+  std::mt19937 rng(9);
+  std::vector<uint8_t> bram(model::pl_hw::BRAM_DEPTH);
+  for (auto &param : bram) {
+    param = static_cast<uint8_t>(rng() & 0xF);
+  }
+  model::pl_hw::Net net;
+  net.load_bram(bram);
+  const model::pl_hw::BatchNet batch_net(net);
+
+  constexpr int N = model::pl_hw::WEIGHTS_PER_NEURON;
+  std::vector<int16_t> inputs(static_cast<size_t>(rows) * N);
+  std::uniform_int_distribution<int> dist(-2048, 2047);
+  for (auto &value : inputs) {
+    value = static_cast<int16_t>(dist(rng));
+  }
+  std::vector<int16_t> batched(inputs.size()), single(inputs.size());
+
+  auto start = Clock::now();
+  batch_net.forward(inputs.data(), batched.data(), rows);
+  const double batch_elapsed = seconds_since(start);
+
+  start = Clock::now();
+  for (int row = 0; row < rows; ++row) {
+    net.forward(&inputs[row * N], &single[row * N]);
+  }
+  const double single_elapsed = seconds_since(start);
+
+  std::cout << "pl_hw net: BatchNet " << batch_elapsed / rows * 1e9 << " ns/row, Net::forward "
+            << single_elapsed / rows * 1e9 << " ns/row"
+            << (batched == single ? " (matches)" : " (MISMATCH)") << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::string map_file = "jnb_map_tb.tmx"; // default map file
+  size_t games = 1024;
+  int frames = 4000;
+
+  // parse command line arguments
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+      map_file = argv[++i];
+    } else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+      games = std::stoul(argv[++i]);
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = std::stoi(argv[++i]);
+    }
+  }
+
+  TileMap tile_map;
+  if (!tile_map.load_from_file(map_file)) {
+    return 1;
+  }
+  auto map = std::make_shared<const MapData>(tile_map);
+
+  bench_single(map_file, frames * 16);
+  bench_step(map_file, frames * 16);
+  bench_snapshot(map_file, frames * 100);
+  bench_replay(map_file, frames / 10);
+  bench_batch(map, games, frames);
+  bench_observe(map, map_file, games, frames / 10);
+  bench_image_observe(map_file, frames * 16);
+  bench_render(map_file, frames * 4);
+  bench_mlp(frames * 100);
+  bench_ga_step(frames / 20);
+  bench_add_normal(frames * 10);
+  bench_gemv(frames * 100);
+  bench_stacked_mlp(games / 4, frames / 10);
+  bench_batched_fitness(map_file, frames);
+  bench_pl_layer(frames * 100);
+  bench_pl_hw(frames * 25);
+
+  return 0;
+}
@@ -3,14 +3,11 @@
 #include <memory>
 #include <random>
 
-#include "jnb_render.h"
+#include "games/jnb.h"
 #include "models/human.h"
-#include "models/mlp_simple.h"
-#include "models/mlp_map_lut.h"
-#include "optimizers/simple.h"
 #include "pixel_game.h"
 
-#include "lodepng.h"
+#include "assets.h"
 #include <verilated.h>
 #include "Vgame_test.h"
 
@@ -22,25 +19,18 @@ int main(int argc, char *argv[]) {
   // pass args to verilated
   Verilated::commandArgs(argc, argv);
 
-  // initialize game state
-  GameState state = init(map_file, 0);
+  // initialize game state. the verilated game drives it, the cpu game only renders it
+  JnBGame cpu(map_file, -1);
+  cpu.init(0);
+  GameState &state = cpu.state;
 
-  PixelGame game("JnB Sim", CELL_SIZE * state.map.width, CELL_SIZE * state.map.height, 640, 480,
-                 60);
-
-  std::vector<uint8_t> spritesheet;
-  uint32_t w, h;
-  auto error = lodepng::decode(spritesheet, w, h, "tiles.png"); // TODO: move path to constexpr
-  if (error) {
-    std::cerr << "Error loading spritesheet: " << lodepng_error_text(error) << std::endl;
-    throw std::runtime_error("Failed to load spritesheet");
-  }
-  std::cout << "Loaded tiles.png" << std::endl;
-  std::cout << "Width: " << w << ", Height: " << h << std::endl;
+  const TileMap &tile_map = assets::get_map(map_file)->tile_map;
+  PixelGame game("JnB Sim", CELL_SIZE * tile_map.width, CELL_SIZE * tile_map.height, 60);
 
   // instantiate Vgame_test
   std::cout << "Instantiating Vgame_test..." << std::endl;
-  auto vgame_test = std::make_shared<Vgame_test>();
+  auto context = std::make_unique<VerilatedContext>();
+  auto vgame_test = std::make_shared<Vgame_test>(context.get());
   std::cout << "done instantiating." << std::endl;
 
   // init with seed
@@ -85,20 +75,23 @@ int main(int argc, char *argv[]) {
   // vgame_test is ready
 
   // make human players
-  auto model1 = std::make_shared<HumanModel>();
-  auto model2 = std::make_shared<HumanModel>();
+  auto model1 = std::make_shared<model::Keyboard<obs::Simple>>();
+  auto model2 = std::make_shared<model::Keyboard<obs::Simple>>();
+  std::vector<obs::Simple> inputs = cpu.build_observation();
+  std::vector<std::vector<float>> actions(2, std::vector<float>(cpu.get_action_count()));
 
-  auto update_lambda = [&state, model1, model2, vgame_test]() {
-    auto p1_input = model1->forward(state, true);
-    auto p2_input = model2->forward(state, false);
+  auto update_lambda = [&cpu, &state, &inputs, &actions, model1, model2, vgame_test]() {
+    cpu.observe(inputs);
+    model1->forward(inputs[0], actions[0]);
+    model2->forward(inputs[1], actions[1]);
 
     // set input
-    vgame_test->p1_input_left = p1_input.left;
-    vgame_test->p1_input_right = p1_input.right;
-    vgame_test->p1_input_jump = p1_input.jump;
-    vgame_test->p2_input_left = p2_input.left;
-    vgame_test->p2_input_right = p2_input.right;
-    vgame_test->p2_input_jump = p2_input.jump;
+    vgame_test->p1_input_left = actions[0][0] > 0;
+    vgame_test->p1_input_right = actions[0][1] > 0;
+    vgame_test->p1_input_jump = actions[0][2] > 0;
+    vgame_test->p2_input_left = actions[1][0] > 0;
+    vgame_test->p2_input_right = actions[1][1] > 0;
+    vgame_test->p2_input_jump = actions[1][2] > 0;
     // go
     vgame_test->go = 1;
     vgame_test->clk = 1;
@@ -120,7 +113,8 @@ int main(int argc, char *argv[]) {
     state.p1.score = vgame_test->p1_score;
     state.p2.score = vgame_test->p2_score;
     state.age = vgame_test->age;
-    // TODO: update coin position (forgot this in vhdl)
+    state.coin_pos.x = vgame_test->coin_x;
+    state.coin_pos.y = vgame_test->coin_y;
 
     // update(state, p1_input, p2_input);
   };
@@ -128,25 +122,16 @@ int main(int argc, char *argv[]) {
   // auto render_lambda = [&state, &spritesheet](SDL_Renderer *renderer) {
   //   render(state, renderer, spritesheet);
   // };
-  auto render_lambda = [&state, &spritesheet](std::vector<uint32_t> &pixels) {
-    render(state, spritesheet, pixels);
+  auto render_lambda = [&cpu](std::vector<uint32_t> &pixels, rendering::RenderTarget &target) {
+    cpu.render(pixels, target);
+    return cpu.get_resolution();
   };
 
   std::vector<std::function<void(SDL_Event &)>> input_handlers;
 
-  // try downcasting each model to HumanModel.
-  // if we can, then grab it's input handler
-  // and add it to the input_handlers vector
-  auto human_model1 = std::dynamic_pointer_cast<HumanModel>(model1);
-  if (human_model1) {
-    auto handle_input_lambda = human_model1->get_input_handler(SDLK_LEFT, SDLK_RIGHT, SDLK_UP);
-    input_handlers.push_back(handle_input_lambda);
-  }
-  auto human_model2 = std::dynamic_pointer_cast<HumanModel>(model2);
-  if (human_model2) {
-    auto handle_input_lambda = human_model2->get_input_handler(SDLK_a, SDLK_d, SDLK_w);
-    input_handlers.push_back(handle_input_lambda);
-  }
+  // player 0 uses arrow keys, player 1 uses wasd
+  input_handlers.push_back(model1->get_input_handler(SDLK_LEFT, SDLK_RIGHT, SDLK_UP));
+  input_handlers.push_back(model2->get_input_handler(SDLK_a, SDLK_d, SDLK_w));
   // input_handlers.push_back([&state, &seed](SDL_Event &event) {
   //   auto k = event.key.keysym.sym;
   //   if (event.type == SDL_KEYDOWN) {
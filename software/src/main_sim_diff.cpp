@@ -0,0 +1,223 @@
+// headless equivalence check between the verilated game (Vgame_test) and JnBGame.
+// runs randomized input episodes on both, one verilator instance per thread, and compares
+// the state after every frame. reports the first divergence it finds.
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+#include <verilated.h>
+#include "Vgame_test.h"
+
+#include "games/jnb.h"
+
+using namespace jnb;
+
+namespace {
+
+struct Divergence {
+  uint64_t episode{std::numeric_limits<uint64_t>::max()};
+  uint64_t seed{0};
+  int frame{0}; // 0 is right after init
+  std::string report{};
+};
+
+void tick(Vgame_test &rtl) {
+  rtl.clk = 1;
+  rtl.eval();
+  rtl.clk = 0;
+  rtl.eval();
+}
+
+void run_until_done(Vgame_test &rtl) {
+  while (!rtl.done) {
+    tick(rtl);
+  }
+}
+
+void rtl_init(Vgame_test &rtl, uint32_t seed) {
+  rtl.swap_start = 0;
+  rtl.go = 0;
+  rtl.seed = seed;
+  rtl.init = 1;
+  tick(rtl);
+  rtl.init = 0;
+  tick(rtl);
+  run_until_done(rtl);
+}
+
+void rtl_step(Vgame_test &rtl, const PlayerInput &in1, const PlayerInput &in2) {
+  rtl.p1_input_left = in1.left;
+  rtl.p1_input_right = in1.right;
+  rtl.p1_input_jump = in1.jump;
+  rtl.p2_input_left = in2.left;
+  rtl.p2_input_right = in2.right;
+  rtl.p2_input_jump = in2.jump;
+  rtl.go = 1;
+  tick(rtl);
+  rtl.go = 0;
+  run_until_done(rtl);
+}
+
+// compares everything game_test exposes. positions only come out as whole pixels, wrapped to
+// the port width. age is not compared, game.vhd never advances it.
+std::string compare(const GameState &cpu, const Vgame_test &rtl) {
+  std::ostringstream out;
+  auto check = [&out](const char *name, int cpu_value, int rtl_value) {
+    if (cpu_value != rtl_value) {
+      out << "  " << name << ": cpu " << cpu_value << ", rtl " << rtl_value << "\n";
+    }
+  };
+  constexpr int POS_MASK = 0xFFF; // p1_x etc are unsigned(F4_UPPER downto 0)
+
+  check("p1.x", cpu.p1.x.to_integer_floor() & POS_MASK, rtl.p1_x);
+  check("p1.y", cpu.p1.y.to_integer_floor() & POS_MASK, rtl.p1_y);
+  check("p2.x", cpu.p2.x.to_integer_floor() & POS_MASK, rtl.p2_x);
+  check("p2.y", cpu.p2.y.to_integer_floor() & POS_MASK, rtl.p2_y);
+  check("p1.x_vel", cpu.p1.x_vel.raw_value(), static_cast<int16_t>(rtl.p1_x_vel));
+  check("p1.y_vel", cpu.p1.y_vel.raw_value(), static_cast<int16_t>(rtl.p1_y_vel));
+  check("p2.x_vel", cpu.p2.x_vel.raw_value(), static_cast<int16_t>(rtl.p2_x_vel));
+  check("p2.y_vel", cpu.p2.y_vel.raw_value(), static_cast<int16_t>(rtl.p2_y_vel));
+  check("p1.score", cpu.p1.score, static_cast<int16_t>(rtl.p1_score));
+  check("p2.score", cpu.p2.score, static_cast<int16_t>(rtl.p2_score));
+  check("coin.x", cpu.coin_pos.x, rtl.coin_x);
+  check("coin.y", cpu.coin_pos.y, rtl.coin_y);
+  return out.str();
+}
+
+// random inputs that are held for a few frames at a time, so players actually get somewhere
+class InputSource {
+public:
+  explicit InputSource(uint64_t seed) : rng(seed) {}
+
+  PlayerInput next(int player) {
+    if (--hold[player] <= 0) {
+      bits[player] = static_cast<uint8_t>(bits_dist(rng));
+      hold[player] = hold_dist(rng);
+    }
+    return unpack_input(bits[player]);
+  }
+
+private:
+  std::mt19937_64 rng;
+  std::uniform_int_distribution<int> bits_dist{0, 7};
+  std::uniform_int_distribution<int> hold_dist{1, 16};
+  uint8_t bits[2]{0, 0};
+  int hold[2]{0, 0};
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::string map_file = "jnb_map_tb.tmx"; // must be the map compiled into game_test
+  uint64_t episodes = 4096;
+  int frames = 2000;
+  uint64_t seed = 0;
+
+  // parse command line arguments
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+      map_file = argv[++i];
+    } else if (strcmp(argv[i], "--episodes") == 0 && i + 1 < argc) {
+      episodes = std::stoull(argv[++i]);
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = std::stoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = std::stoull(argv[++i]);
+    }
+  }
+
+  Verilated::commandArgs(argc, argv);
+
+  // loads the map once, every thread plays on a clone
+  const JnBGame reference(map_file, -1);
+
+  Divergence first{};
+  // the lowest diverged episode so far. only later episodes are skipped, every earlier one is
+  // still played, so the reported divergence doesn't depend on thread timing.
+  constexpr uint64_t NONE = std::numeric_limits<uint64_t>::max();
+  std::atomic<uint64_t> lowest_diverged{NONE};
+  std::atomic<uint64_t> frames_run{0};
+  const auto start = std::chrono::steady_clock::now();
+
+#pragma omp parallel
+  {
+    // separate contexts keep the verilated models independent across threads
+    auto context = std::make_unique<VerilatedContext>();
+    auto rtl = std::make_unique<Vgame_test>(context.get());
+    auto game = reference.clone();
+    auto &cpu = static_cast<JnBGame &>(*game);
+    std::vector<std::vector<float>> actions(2, std::vector<float>(3));
+    uint64_t local_frames = 0;
+
+#pragma omp for schedule(dynamic)
+    for (int64_t e = 0; e < static_cast<int64_t>(episodes); ++e) {
+      if (static_cast<uint64_t>(e) > lowest_diverged.load(std::memory_order_relaxed)) {
+        continue;
+      }
+      const uint64_t episode_seed = seed + e;
+      InputSource inputs(episode_seed);
+
+      cpu.init(episode_seed);
+      rtl_init(*rtl, static_cast<uint32_t>(episode_seed));
+
+      std::string report = compare(cpu.state, *rtl);
+      int frame = 0;
+      while (report.empty() && frame < frames) {
+        const PlayerInput in1 = inputs.next(0);
+        const PlayerInput in2 = inputs.next(1);
+        for (int p = 0; p < 2; ++p) {
+          const PlayerInput &in = p == 0 ? in1 : in2;
+          actions[p][0] = in.left;
+          actions[p][1] = in.right;
+          actions[p][2] = in.jump;
+        }
+        cpu.update(actions);
+        rtl_step(*rtl, in1, in2);
+        ++frame;
+        report = compare(cpu.state, *rtl);
+      }
+      local_frames += frame;
+
+      if (!report.empty()) {
+        uint64_t lowest = lowest_diverged.load(std::memory_order_relaxed);
+        while (static_cast<uint64_t>(e) < lowest &&
+               !lowest_diverged.compare_exchange_weak(lowest, e, std::memory_order_relaxed)) {
+        }
+#pragma omp critical
+        {
+          if (static_cast<uint64_t>(e) < first.episode) {
+            first = {static_cast<uint64_t>(e), episode_seed, frame, report};
+          }
+        }
+      }
+    }
+
+    frames_run += local_frames;
+    rtl->final();
+  }
+
+  const double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << frames_run << " frames in " << elapsed << " s ("
+            << frames_run / elapsed * 60.0 << " frames/min, " << omp_get_max_threads()
+            << " threads)" << std::endl;
+
+  if (lowest_diverged != NONE) {
+    std::cout << "DIVERGED: episode " << first.episode << " (seed " << first.seed << ") at frame "
+              << first.frame << (first.frame == 0 ? " (after init)" : "") << "\n"
+              << first.report;
+    return 1;
+  }
+  std::cout << "no divergence in " << episodes << " episodes of " << frames << " frames"
+            << std::endl;
+  return 0;
+}
@@ -44,11 +44,25 @@ void SimpleModelTileEmb::forward(const obs::TileCoords &observation, std::vector
 void SimpleModelTileEmb::mutate(std::mt19937 &rng, float mutation_rate) {
   // mutate the base model and the embeddings
   base_model->mutate(rng, mutation_rate);
+  mutation::Rng fast(rng);
   for (auto &embedding : embeddings) {
-    embedding.mutate(rng, mutation_rate);
+    embedding.mutate(fast, mutation_rate);
   }
 }
 
+uint64_t SimpleModelTileEmb::get_hash() const {
+  // not hashable if the base model isn't
+  uint64_t h = base_model->get_hash();
+  if (h == 0) {
+    return 0;
+  }
+  h = hash_combine(h, separate_embeddings_per_coord);
+  for (const auto &embedding : embeddings) {
+    h = embedding.hash(h);
+  }
+  return h;
+}
+
 void SimpleModelTileEmb::init(const obs::TileCoords &sample_observation, size_t output_size, std::mt19937 &rng) {
   // init base model
   size_t total_input_size = sample_observation.simple.size() + embedding_vec_size * embedding_coord_count;
@@ -7,6 +7,7 @@
 #include "jnb.h"
 #include "neural_net.h"
 #include "model.h"
+#include "mutation.h"
 #include "observation_types.h"
 
 namespace model {
@@ -40,13 +41,16 @@ struct TileEmbeddings {
     }
   }
 
-  void mutate(std::mt19937 &rng, float mutation_rate) {
+  void mutate(mutation::Rng &rng, float mutation_rate) {
     // xavier/glorot initialization
     float stddev = std::sqrt(2.0f / (channels));
-    std::normal_distribution<float> dist(0.0f, stddev * mutation_rate);
-    for (auto &val : data) {
-      val += dist(rng);
-    }
+    mutation::add_normal(rng, data.data(), data.size(), stddev * mutation_rate);
+  }
+
+  uint64_t hash(uint64_t h) const {
+    h = hash_combine(h, (static_cast<uint64_t>(width) << 32) | static_cast<uint32_t>(height));
+    h = hash_combine(h, channels);
+    return hash_bytes(h, data.data(), data.size() * sizeof(float));
   }
 };
 
@@ -76,6 +80,7 @@ public:
   std::string get_name() const override {
     return "SimpleModelTileEmb";
   }
+  uint64_t get_hash() const override;
 
 private:
   size_t map_width_tiles;
@@ -17,6 +17,9 @@ public:
   void forward(const obs::Simple &observation, std::vector<float> &action) override {
     net.forward(observation.data(), action.data());
   }
+  void forward_flat(std::span<const float> observation, std::vector<float> &action) override {
+    net.forward(observation.data(), action.data());
+  }
   void mutate(std::mt19937 &rng, float mutation_rate) override;
   void init(const obs::Simple &sample_observation, size_t output_size, std::mt19937 &rng) override {
     net.init(rng, sample_observation.size(), hidden_size, hidden_count, output_size);
@@ -24,9 +27,24 @@ public:
   std::shared_ptr<Model<obs::Simple>> clone() const override {
     return std::make_shared<SimpleMLP>(*this);
   }
+  bool copy_from(const Model<obs::Simple> &other) override {
+    const auto *mlp = dynamic_cast<const SimpleMLP *>(&other);
+    if (!mlp) {
+      return false;
+    }
+    // same shape, so the parameter arena is copied in place
+    *this = *mlp;
+    return true;
+  }
   std::string get_name() const override {
     return "SimpleMLP";
   }
+  uint64_t get_hash() const override {
+    return net.hash();
+  }
+  const DynamicNeuralNet<float> &get_net() const {
+    return net;
+  }
 
 private:
   size_t hidden_size;
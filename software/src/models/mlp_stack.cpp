@@ -0,0 +1,151 @@
+#include "mlp_stack.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace model {
+
+void StackedMLP::clear() {
+  layers.clear();
+  single = nullptr;
+  block = nullptr;
+  hidden_width = 0;
+  net_stride = 0;
+  net_count = 0;
+  params.clear();
+}
+
+bool StackedMLP::accepts(const DynamicNeuralNet<float> &net) const {
+  if (net.layers.empty()) {
+    return false;
+  }
+  if (net_count == 0) {
+    return true;
+  }
+  if (net.layers.size() != layers.size() || net.get_params().size() != net_stride) {
+    return false;
+  }
+  for (size_t i = 0; i < layers.size(); ++i) {
+    if (net.layers[i].inputs != layers[i].inputs || net.layers[i].outputs != layers[i].outputs) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t StackedMLP::add(const DynamicNeuralNet<float> &net) {
+  assert(accepts(net));
+  const auto arena = net.get_params();
+  if (net_count == 0) {
+    // the arena layout only depends on the shape, so the first net's offsets hold for all
+    for (const auto &layer : net.layers) {
+      layers.push_back({layer.inputs, layer.outputs, layer.stride,
+                        static_cast<size_t>(layer.weights - arena.data()),
+                        static_cast<size_t>(layer.bias - arena.data())});
+    }
+    hidden_width = net.layers[0].outputs;
+    const auto isa = gemv::get_isa();
+    const int inputs = net.layers.front().inputs;
+    const int hidden_count = static_cast<int>(net.layers.size()) - 1;
+    const int outputs = net.layers.back().outputs;
+    const int hidden = net.layers[0].outputs;
+    single = gemv::find_net_forward(isa, inputs, hidden, hidden_count, outputs);
+    block = gemv::find_net_forward_block(isa, inputs, hidden, hidden_count, outputs);
+    net_stride = arena.size();
+  }
+  params.insert(params.end(), arena.begin(), arena.end());
+  return static_cast<uint32_t>(net_count++);
+}
+
+void StackedMLP::forward(std::span<const uint32_t> nets, const float *inputs,
+                         size_t input_stride, float *outputs, size_t output_stride) const {
+  if (net_count == 0 || nets.empty()) {
+    return;
+  }
+
+  // the row order, reused by every call on this thread
+  thread_local std::vector<uint32_t> order{};
+  thread_local std::vector<uint32_t> starts{};
+  const size_t rows = nets.size();
+
+  // counting sort of the rows by net, so rows sharing a net share weight loads
+  starts.assign(net_count + 1, 0);
+  for (auto net : nets) {
+    if (net != NO_NET) {
+      ++starts[net + 1];
+    }
+  }
+  for (size_t n = 0; n < net_count; ++n) {
+    starts[n + 1] += starts[n];
+  }
+  order.resize(starts[net_count]);
+  for (size_t row = 0; row < rows; ++row) {
+    if (nets[row] != NO_NET) {
+      order[starts[nets[row]]++] = static_cast<uint32_t>(row);
+    }
+  }
+
+  if (block == nullptr) {
+    forward_layers(nets, order.data(), order.size(), inputs, input_stride, outputs,
+                   output_stride);
+    return;
+  }
+
+  // the whole net in one call per NET_BLOCK_ROWS rows of a net, activations never leave the
+  // kernel. starts[n] is now the end of net n's rows.
+  size_t begin = 0;
+  for (size_t n = 0; n < net_count; ++n) {
+    const float *net_params = params.data() + n * net_stride;
+    const size_t end = starts[n];
+    size_t i = begin;
+    for (; i + gemv::NET_BLOCK_ROWS <= end; i += gemv::NET_BLOCK_ROWS) {
+      const float *in[gemv::NET_BLOCK_ROWS];
+      float *out[gemv::NET_BLOCK_ROWS];
+      for (int r = 0; r < gemv::NET_BLOCK_ROWS; ++r) {
+        in[r] = inputs + order[i + r] * input_stride;
+        out[r] = outputs + order[i + r] * output_stride;
+      }
+      block(net_params, in, out);
+    }
+    for (; i < end; ++i) {
+      single(net_params, inputs + order[i] * input_stride, outputs + order[i] * output_stride);
+    }
+    begin = end;
+  }
+}
+
+void StackedMLP::forward_layers(std::span<const uint32_t> nets, const uint32_t *order,
+                                size_t count, const float *inputs, size_t input_stride,
+                                float *outputs, size_t output_stride) const {
+  // two activation buffers, a row of hidden_width per batch row. reused by every call on this
+  // thread.
+  thread_local std::vector<float> workspace{};
+  const size_t rows = nets.size();
+  if (workspace.size() < rows * hidden_width * 2) {
+    workspace.resize(rows * hidden_width * 2);
+  }
+  float *current = workspace.data();
+  float *next = workspace.data() + rows * hidden_width;
+
+  const auto isa = gemv::get_isa();
+  for (size_t i = 0; i < layers.size(); ++i) {
+    const auto &shape = layers[i];
+    const gemv::StackedLayer layer{params.data() + shape.weights_offset,
+                                   params.data() + shape.bias_offset,
+                                   net_stride,
+                                   shape.inputs,
+                                   shape.outputs,
+                                   shape.stride};
+    const bool first = i == 0;
+    const bool last = i + 1 == layers.size();
+    // same as DynamicNeuralNet::forward: ReLU on every layer but the output one
+    gemv::forward_batch(isa, layer, nets.data(), order, count,
+                        first ? inputs : current, first ? input_stride : hidden_width,
+                        last ? outputs : next, last ? output_stride : hidden_width, !last);
+    if (!last) {
+      std::swap(current, next);
+    }
+  }
+}
+
+} // namespace model
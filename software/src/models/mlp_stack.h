@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "aligned_allocator.h"
+#include "gemv.h"
+#include "neural_net.h"
+
+namespace model {
+
+// the parameters of many DynamicNeuralNet<float> with one shape, copied into a single
+// [net][arena] buffer, so one forward call runs a different net on every row of a batch. meant
+// for evaluating a whole population on games stepped in lockstep. shapes with a compiled
+// gemv::NetForwardBlock run a few rows of a net through the whole net at once, other shapes one
+// gemv::forward_batch call per layer.
+class StackedMLP {
+public:
+  // rows with no net are skipped by forward
+  static constexpr uint32_t NO_NET = UINT32_MAX;
+
+  // drop every net, keeping the memory
+  void clear();
+
+  // true if net can be added, i.e. it has the same shape as the nets already stacked
+  bool accepts(const DynamicNeuralNet<float> &net) const;
+
+  // copy net's parameters in, returns its index for forward. net must be accepted.
+  uint32_t add(const DynamicNeuralNet<float> &net);
+
+  size_t size() const {
+    return net_count;
+  }
+
+  // outputs[row] = net nets[row] (inputs[row]), rows of NO_NET are left untouched.
+  // inputs and outputs are rows input_stride and output_stride floats apart. safe to call from
+  // several threads at once.
+  void forward(std::span<const uint32_t> nets, const float *inputs, size_t input_stride,
+               float *outputs, size_t output_stride) const;
+
+private:
+  struct LayerShape {
+    int inputs;
+    int outputs;
+    int stride;
+    size_t weights_offset; // into one net's arena
+    size_t bias_offset;
+  };
+
+  void forward_layers(std::span<const uint32_t> nets, const uint32_t *order, size_t count,
+                      const float *inputs, size_t input_stride, float *outputs,
+                      size_t output_stride) const;
+
+  std::vector<LayerShape> layers{};
+  // compiled kernels for the whole net, nullptr if the shape has none
+  gemv::NetForward single{nullptr};
+  gemv::NetForwardBlock block{nullptr};
+  size_t hidden_width{0};
+  size_t net_stride{0}; // arena size
+  size_t net_count{0};
+  std::vector<float, AlignedAllocator<float, 64>> params{};
+};
+
+} // namespace model
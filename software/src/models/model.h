@@ -1,8 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <random>
+#include <span>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 namespace model {
 
@@ -21,8 +25,29 @@ public:
   // sample_observation is purely just for the model to see the shape of a sample
   virtual void init(const ObsType &sample_observation, size_t output_size, std::mt19937 &rng) {}
   virtual void forward(const ObsType &observation, std::vector<float> &action) {}
+  // forward from a flat float observation owned by someone else, like a slice of a
+  // jnb::ObservationBatch. only meaningful when ObsType is a float vector. the default copies
+  // into one, models that just read floats override it to skip the copy.
+  virtual void forward_flat(std::span<const float> observation, std::vector<float> &action) {
+    if constexpr (std::is_same_v<ObsType, std::vector<float>>) {
+      thread_local ObsType copy{};
+      copy.assign(observation.begin(), observation.end());
+      forward(copy, action);
+    }
+  }
   virtual std::shared_ptr<Model<ObsType>> clone() const = 0;
+  // make this a copy of other, reusing this model's buffers. returns false when other isn't the
+  // same kind of model, the caller then has to clone instead.
+  virtual bool copy_from(const Model<ObsType> &other) {
+    return false;
+  }
   virtual std::string get_name() const = 0;
+  // content hash of everything that affects forward(). two models with the same hash must play
+  // identically, so fitness results can be reused. 0 means not hashable, which is the default
+  // and the right answer for stateful or externally driven models.
+  virtual uint64_t get_hash() const {
+    return 0;
+  }
 };
 
 } // namespace model
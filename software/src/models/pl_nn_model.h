@@ -17,6 +17,9 @@ public:
   PLNNModel() {}
   ~PLNNModel() = default;
   void forward(const obs::Simple &observation, std::vector<float> &action) {
+    forward_flat(observation, action);
+  }
+  void forward_flat(std::span<const float> observation, std::vector<float> &action) override {
     int observation_int[32];
     int output_int[32];
 
@@ -87,9 +90,20 @@ public:
   std::shared_ptr<Model<obs::Simple>> clone() const override {
     return std::make_shared<PLNNModel>(*this);
   }
+  bool copy_from(const Model<obs::Simple> &other) override {
+    const auto *pl = dynamic_cast<const PLNNModel *>(&other);
+    if (!pl) {
+      return false;
+    }
+    *this = *pl;
+    return true;
+  }
   std::string get_name() const override {
     return "PLNNModel";
   }
+  uint64_t get_hash() const override {
+    return net.hash();
+  }
 
 private:
   StaticPLNet<32, 2> net;
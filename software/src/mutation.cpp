@@ -0,0 +1,243 @@
+#include "mutation.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "cpu_isa.h"
+
+// same approach as gemv.cpp: one `#pragma omp simd` kernel, compiled again with target
+// attributes on gcc/clang x86 and picked at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MUTATION_X86 1
+#define MUTATION_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define MUTATION_X86 0
+#define MUTATION_ALWAYS_INLINE inline
+#endif
+
+// the kernels must give the same bits on every target, or a genome would rebuild different
+// parameters depending on the cpu. with fma enabled the compiler would otherwise fuse the
+// Box-Muller multiply-adds, which rounds once instead of twice.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace mutation {
+
+namespace {
+
+constexpr int LANES = Rng::LANES;
+
+uint64_t splitmix64(uint64_t &x) {
+  uint64_t z = (x += 0x9E3779B97F4A7C15);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+  return z ^ (z >> 31);
+}
+
+// one xoshiro128+ step of every lane
+MUTATION_ALWAYS_INLINE void step(uint32_t (&state)[4][LANES], uint32_t *out) {
+#pragma omp simd
+  for (int l = 0; l < LANES; ++l) {
+    const uint32_t s0 = state[0][l];
+    const uint32_t s1 = state[1][l];
+    uint32_t s2 = state[2][l];
+    uint32_t s3 = state[3][l];
+    out[l] = s0 + s3;
+    const uint32_t t = s1 << 9;
+    s2 ^= s0;
+    s3 ^= s1;
+    state[1][l] = s1 ^ s2;
+    state[0][l] = s0 ^ s3;
+    state[2][l] = s2 ^ t;
+    state[3][l] = (s3 << 11) | (s3 >> 21);
+  }
+}
+
+// natural log for x in (0, 1], cephes' logf polynomial. no special cases, no libm call, so it
+// vectorizes.
+MUTATION_ALWAYS_INLINE float fast_log(float x) {
+  const uint32_t bits = std::bit_cast<uint32_t>(x);
+  // x = m * 2^e with m in [sqrt(0.5), sqrt(2))
+  int e = static_cast<int>(bits >> 23) - 126;
+  const uint32_t mantissa = bits & 0x007FFFFF;
+  // m in [0.5, 1) below sqrt(0.5) gets doubled. both are decided on the bits, a select between
+  // float adds could trap, which keeps the loop from vectorizing before AVX-512.
+  const bool small = (mantissa | 0x3F000000) < 0x3F3504F3;
+  e -= small;
+  const float m = std::bit_cast<float>(mantissa | (small ? 0x3F800000u : 0x3F000000u)) - 1.0f;
+
+  const float z = m * m;
+  float y = 7.0376836292e-2f;
+  y = y * m - 1.1514610310e-1f;
+  y = y * m + 1.1676998740e-1f;
+  y = y * m - 1.2420140846e-1f;
+  y = y * m + 1.4249322787e-1f;
+  y = y * m - 1.6668057665e-1f;
+  y = y * m + 2.0000714765e-1f;
+  y = y * m - 2.4999993993e-1f;
+  y = y * m + 3.3333331174e-1f;
+  y = y * m * z;
+  const float fe = static_cast<float>(e);
+  y += -2.12194440e-4f * fe;
+  y += -0.5f * z;
+  return m + y + 0.693359375f * fe;
+}
+
+// sqrt for x >= 0 from the rsqrt bit trick and three Newton steps, exact to float rounding.
+// std::sqrt keeps its errno path, which stops the loop from vectorizing.
+MUTATION_ALWAYS_INLINE float fast_sqrt(float x) {
+  // clamped on the bits too, positive floats order like ints and everything else goes to 1e-30
+  const float clamped =
+      std::bit_cast<float>(std::max(std::bit_cast<int32_t>(x), std::bit_cast<int32_t>(1e-30f)));
+  float y = std::bit_cast<float>(0x5F375A86 - (std::bit_cast<uint32_t>(clamped) >> 1));
+  // written out, an inner loop would keep the caller's loop from vectorizing
+  y = y * (1.5f - 0.5f * clamped * y * y);
+  y = y * (1.5f - 0.5f * clamped * y * y);
+  y = y * (1.5f - 0.5f * clamped * y * y);
+  return x * y;
+}
+
+// sin and cos of 2 pi v for v in [0, 1], cephes' polynomials on the nearest quarter turn
+MUTATION_ALWAYS_INLINE void fast_sincos_turns(float v, float &s, float &c) {
+  // v >= 0, so truncating rounds down without a floor call
+  const int nearest = static_cast<int>(v * 4.0f + 0.5f);
+  const float quarter = static_cast<float>(nearest);
+  const int q = nearest & 3;
+  const float r = (v - quarter * 0.25f) * 6.2831853072f; // [-pi/4, pi/4]
+  const float r2 = r * r;
+  const float sin_r =
+      r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+  const float cos_r = 1.0f - 0.5f * r2 +
+                      r2 * r2 *
+                          (4.166664568298827e-2f +
+                           r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+  // rotate by q quarter turns
+  const float sq = (q & 1) ? cos_r : sin_r;
+  const float cq = (q & 1) ? sin_r : cos_r;
+  s = (q & 2) ? -sq : sq;
+  c = ((q + 1) & 2) ? -cq : cq;
+}
+
+// 2 * LANES normals from two blocks of uniforms, Box-Muller
+MUTATION_ALWAYS_INLINE void normals(uint32_t (&state)[4][LANES], float *out) {
+  alignas(64) uint32_t a[LANES];
+  alignas(64) uint32_t b[LANES];
+  step(state, a);
+  step(state, b);
+#pragma omp simd
+  for (int l = 0; l < LANES; ++l) {
+    const float u = static_cast<float>((a[l] >> 8) + 1) * 0x1.0p-24f; // (0, 1]
+    const float v = static_cast<float>(b[l] >> 8) * 0x1.0p-24f;       // [0, 1)
+    const float radius = fast_sqrt(-2.0f * fast_log(u));
+    float s, c;
+    fast_sincos_turns(v, s, c);
+    out[l] = radius * c;
+    out[LANES + l] = radius * s;
+  }
+}
+
+// values[r * stride + c] += stddev * N(0, 1) for c < columns. normals left over from one row
+// carry on into the next, so narrow rows don't waste most of each block.
+MUTATION_ALWAYS_INLINE void add_normal_impl(uint32_t (&state)[4][LANES], float *values,
+                                            size_t rows, size_t columns, size_t stride,
+                                            float stddev) {
+  constexpr size_t BLOCK = 2 * LANES;
+  alignas(64) float n[BLOCK];
+  size_t available = 0;
+  for (size_t r = 0; r < rows; ++r) {
+    float *row = values + r * stride;
+    for (size_t c = 0; c < columns;) {
+      if (available == 0) {
+        normals(state, n);
+        available = BLOCK;
+      }
+      const size_t take = std::min(columns - c, available);
+      const float *noise = n + (BLOCK - available);
+#pragma omp simd
+      for (size_t k = 0; k < take; ++k) {
+        row[c + k] += stddev * noise[k];
+      }
+      c += take;
+      available -= take;
+    }
+  }
+  // the unused normals of the last block are dropped
+}
+
+void add_normal_generic(uint32_t (&state)[4][LANES], float *values, size_t rows, size_t columns,
+                        size_t stride, float stddev) {
+  add_normal_impl(state, values, rows, columns, stride, stddev);
+}
+
+#if MUTATION_X86
+__attribute__((target("avx2,fma"))) void add_normal_avx2(uint32_t (&state)[4][LANES],
+                                                         float *values, size_t rows,
+                                                         size_t columns, size_t stride,
+                                                         float stddev) {
+  add_normal_impl(state, values, rows, columns, stride, stddev);
+}
+
+__attribute__((target("avx512f"))) void add_normal_avx512(uint32_t (&state)[4][LANES],
+                                                          float *values, size_t rows,
+                                                          size_t columns, size_t stride,
+                                                          float stddev) {
+  add_normal_impl(state, values, rows, columns, stride, stddev);
+}
+#endif
+
+} // namespace
+
+Rng::Rng(std::mt19937 &seed_source) {
+  // 64 bits from the caller's generator, spread over every lane by splitmix64
+  uint64_t seed = (static_cast<uint64_t>(seed_source()) << 32) | seed_source();
+  for (int l = 0; l < LANES; ++l) {
+    for (int w = 0; w < 4; w += 2) {
+      const uint64_t bits = splitmix64(seed);
+      state[w][l] = static_cast<uint32_t>(bits);
+      state[w + 1][l] = static_cast<uint32_t>(bits >> 32);
+    }
+  }
+}
+
+void Rng::refill() {
+  step(state, block);
+  used = 0;
+}
+
+// SCALAR runs the same kernel compiled for the baseline target
+void add_normal_rows(cpu::Isa isa, Rng &rng, float *values, size_t rows, size_t columns,
+                     size_t stride, float stddev) {
+  switch (isa) {
+#if MUTATION_X86
+    case cpu::Isa::AVX512:
+      add_normal_avx512(rng.state, values, rows, columns, stride, stddev);
+      break;
+    case cpu::Isa::AVX2:
+      add_normal_avx2(rng.state, values, rows, columns, stride, stddev);
+      break;
+#endif
+    default:
+      add_normal_generic(rng.state, values, rows, columns, stride, stddev);
+      break;
+  }
+}
+
+void add_normal_rows(Rng &rng, float *values, size_t rows, size_t columns, size_t stride,
+                     float stddev) {
+  static const cpu::Isa isa = cpu::detect_isa();
+  add_normal_rows(isa, rng, values, rows, columns, stride, stddev);
+}
+
+void add_normal(Rng &rng, float *values, size_t count, float stddev) {
+  add_normal_rows(rng, values, 1, count, count, stddev);
+}
+
+void fill_normal(Rng &rng, float *out, size_t count) {
+  std::fill_n(out, count, 0.0f);
+  add_normal(rng, out, count, 1.0f);
+}
+
+} // namespace mutation
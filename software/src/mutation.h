@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+#include "cpu_isa.h"
+
+// the random numbers behind every model's mutate. one Rng is seeded from the caller's
+// std::mt19937 per mutate call, then feeds all of that model's parameters:
+// - add_normal perturbs floats with batched Box-Muller normals.
+// - for_each_selected visits each index with some probability, jumping between the chosen ones
+//   with geometric skips so unchosen parameters cost no random numbers.
+namespace mutation {
+
+// LANES independent xoshiro128+ streams, stepped together so a block of uniforms is a few
+// vector instructions. scalar draws are served from the last block.
+class Rng {
+public:
+  static constexpr int LANES = 16;
+
+  explicit Rng(std::mt19937 &seed_source);
+
+  // 32 random bits
+  uint32_t next() {
+    if (used == LANES) {
+      refill();
+    }
+    return block[used++];
+  }
+
+  // uniform in (0, 1], never 0 so its log is finite
+  float uniform() {
+    return static_cast<float>((next() >> 8) + 1) * 0x1.0p-24f;
+  }
+
+  // uniform in [0, n), n <= 2^16
+  uint32_t below(uint32_t n) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(next() >> 16) * n) >> 16);
+  }
+
+  // the xoshiro128+ state, [word][lane]
+  alignas(64) uint32_t state[4][LANES];
+
+private:
+  void refill();
+
+  alignas(64) uint32_t block[LANES];
+  int used{LANES};
+};
+
+// values[i] += stddev * N(0, 1) for count values
+void add_normal(Rng &rng, float *values, size_t count, float stddev);
+
+// add_normal on the first columns values of rows rows, stride apart. what lies between the rows
+// is left alone.
+void add_normal_rows(Rng &rng, float *values, size_t rows, size_t columns, size_t stride,
+                     float stddev);
+
+// add_normal_rows on a given kernel instead of the detected one, which the cpu must support.
+// every kernel gives the same bits.
+void add_normal_rows(cpu::Isa isa, Rng &rng, float *values, size_t rows, size_t columns,
+                     size_t stride, float stddev);
+
+// fill out with count N(0, 1) values
+void fill_normal(Rng &rng, float *out, size_t count);
+
+// add_normal for other parameter types, through a block of float normals
+template <typename T> void add_normal(Rng &rng, T *values, size_t count, float stddev) {
+  float noise[2 * Rng::LANES];
+  for (size_t i = 0; i < count; i += 2 * Rng::LANES) {
+    const size_t n = std::min(count - i, size_t{2 * Rng::LANES});
+    fill_normal(rng, noise, n);
+    for (size_t k = 0; k < n; ++k) {
+      values[i + k] += static_cast<T>(stddev * noise[k]);
+    }
+  }
+}
+
+// call visit(i) for every i < count chosen with the given probability, in increasing order. the
+// gaps between chosen indices are drawn directly, so the cost is one uniform per chosen index.
+template <typename Visit>
+void for_each_selected(Rng &rng, size_t count, float probability, Visit &&visit) {
+  if (probability >= 1.0f) {
+    for (size_t i = 0; i < count; ++i) {
+      visit(i);
+    }
+    return;
+  }
+  if (!(probability > 0.0f)) {
+    return;
+  }
+  // the number of unchosen indices before the next chosen one is geometric
+  const float scale = 1.0f / std::log1p(-probability);
+  auto skip = [&]() {
+    const float gap = std::floor(std::log(rng.uniform()) * scale);
+    return gap < static_cast<float>(count) ? static_cast<size_t>(gap) : count;
+  };
+  for (size_t i = skip(); i < count; i += 1 + skip()) {
+    visit(i);
+  }
+}
+
+} // namespace mutation
@@ -1,8 +1,18 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <random>
+#include <span>
+#include <string>
+#include <type_traits>
 #include <vector>
 
+#include "aligned_allocator.h"
+#include "gemv.h"
+#include "mutation.h"
+#include "param_hash.h"
+
 namespace model {
 
 // a staticly allocated neural network with a generic parameter type
@@ -34,24 +44,17 @@ template <typename T, int inputs, int outputs> struct StaticLayer {
     }
   }
 
-  void mutate(std::mt19937 &rng, float mutation_rate) {
-    // calculate the initial standard deviation used during initialization
-    float init_stddev = std::sqrt(2.0f / (inputs + outputs));
-
+  void mutate(mutation::Rng &rng, float mutation_rate) {
     // scale mutation rate by the initial stddev
-    float scaled_mutation_rate = mutation_rate * init_stddev;
-
-    // create distribution for mutations
-    std::normal_distribution<float> dist(0.0f, scaled_mutation_rate);
+    float scaled_mutation_rate = mutation_rate * std::sqrt(2.0f / (inputs + outputs));
 
-    // mutate weights
-    for (int i = 0; i < outputs; ++i) {
-      for (int j = 0; j < inputs; ++j) {
-        weights[i][j] += dist(rng);
-      }
-      // mutate bias
-      bias[i] += dist(rng);
-    }
+    // weights and bias are each one contiguous block
+    mutation::add_normal(rng, &weights[0][0], outputs * inputs, scaled_mutation_rate);
+    mutation::add_normal(rng, bias, outputs, scaled_mutation_rate);
+  }
+  uint64_t hash(uint64_t h = PARAM_HASH_SEED) const {
+    h = hash_bytes(h, weights, sizeof(weights));
+    return hash_bytes(h, bias, sizeof(bias));
   }
 };
 
@@ -96,37 +99,44 @@ struct StaticNeuralNet {
   }
 
   void mutate(std::mt19937 &rng, float mutation_rate) {
-    // mutate all layers
-    input_layer.mutate(rng, mutation_rate);
+    // mutate all layers from one fast generator
+    mutation::Rng fast(rng);
+    input_layer.mutate(fast, mutation_rate);
     for (int i = 0; i < hidden_count - 1; ++i) {
-      hidden_layers[i].mutate(rng, mutation_rate);
+      hidden_layers[i].mutate(fast, mutation_rate);
     }
-    output_layer.mutate(rng, mutation_rate);
+    output_layer.mutate(fast, mutation_rate);
+  }
+
+  uint64_t hash(uint64_t h = PARAM_HASH_SEED) const {
+    h = input_layer.hash(h);
+    for (int i = 0; i < hidden_count - 1; ++i) {
+      h = hidden_layers[i].hash(h);
+    }
+    return output_layer.hash(h);
   }
 };
 
+// a view of one layer's parameters inside a DynamicNeuralNet arena. weights are input-major:
+// input j's weights to every output are one row of `stride` values, padded to whole cache lines
+// so gemv::forward can read them with aligned loads.
 template <typename T>
 struct DynamicLayer {
   int inputs;
   int outputs;
-  std::vector<T> weights;
-  std::vector<T> bias;
+  int stride;
+  T *weights;
+  T *bias; // padded to stride
 
-  T get_w(int input, int output) {
-    return weights[output * inputs + input];
+  T get_w(int input, int output) const {
+    return weights[input * stride + output];
   }
 
   void set_w(int input, int output, T value) {
-    weights[output * inputs + input] = value;
+    weights[input * stride + output] = value;
   }
 
-  void init(std::mt19937 &rng, int inputs, int outputs) {
-    // allocate memory
-    this->inputs = inputs;
-    this->outputs = outputs;
-    weights.resize(inputs * outputs);
-    bias.resize(outputs);
-
+  void init(std::mt19937 &rng) {
     // xavier/glorot initialization
     float stddev = std::sqrt(2.0f / (inputs + outputs));
     std::normal_distribution<float> dist(0.0f, stddev);
@@ -138,66 +148,128 @@ struct DynamicLayer {
     }
   }
 
-  void forward(const T *input, T *output, bool activate = true) {
+  void forward(const T *input, T *output, bool activate = true) const {
+    if constexpr (std::is_same_v<T, float>) {
+      gemv::forward(gemv::get_isa(), weights, bias, inputs, outputs, stride, input, output,
+                    activate);
+    } else {
+      forward_scalar(input, output, activate);
+    }
+  }
+
+  // reference path, one output at a time
+  void forward_scalar(const T *input, T *output, bool activate = true) const {
     for (int i = 0; i < outputs; ++i) {
-      output[i] = bias[i];
+      T sum = bias[i];
       for (int j = 0; j < inputs; ++j) {
-        output[i] += get_w(j, i) * input[j];
+        sum += get_w(j, i) * input[j];
       }
       // activation function (ReLU)
-      if (activate)
-        output[i] = std::max(static_cast<T>(0), output[i]);
+      output[i] = activate ? std::max(static_cast<T>(0), sum) : sum;
     }
   }
 
-  void mutate(std::mt19937 &rng, float mutation_rate) {
-    // calculate the initial standard deviation used during initialization
-    float init_stddev = std::sqrt(2.0f / (inputs + outputs));
-
+  void mutate(mutation::Rng &rng, float mutation_rate) {
     // scale mutation rate by the initial stddev
-    float scaled_mutation_rate = mutation_rate * init_stddev;
-
-    // create distribution for mutations
-    std::normal_distribution<float> dist(0.0f, scaled_mutation_rate);
+    float scaled_mutation_rate = mutation_rate * std::sqrt(2.0f / (inputs + outputs));
 
-    // mutate weights
-    for (int i = 0; i < outputs; ++i) {
+    // every weight row and the bias, the padding stays zero
+    if constexpr (std::is_same_v<T, float>) {
+      mutation::add_normal_rows(rng, weights, inputs, outputs, stride, scaled_mutation_rate);
+    } else {
       for (int j = 0; j < inputs; ++j) {
-        set_w(j, i, get_w(j, i) + dist(rng));
+        mutation::add_normal(rng, weights + static_cast<size_t>(j) * stride, outputs,
+                             scaled_mutation_rate);
       }
-      // mutate bias
-      bias[i] += dist(rng);
     }
+    mutation::add_normal(rng, bias, outputs, scaled_mutation_rate);
+  }
+
+  // the shape is part of the hash. padding is always zero, so hashing it is harmless.
+  uint64_t hash(uint64_t h = PARAM_HASH_SEED) const {
+    h = hash_combine(h, (static_cast<uint64_t>(inputs) << 32) | static_cast<uint32_t>(outputs));
+    h = hash_bytes(h, weights, static_cast<size_t>(inputs) * stride * sizeof(T));
+    return hash_bytes(h, bias, outputs * sizeof(T));
   }
 };
 
+// a fully connected net with every parameter in one aligned arena, so copying, mutating and
+// hashing walk a single buffer. forward allocates nothing. common float shapes run a kernel
+// compiled for that exact shape (gemv::find_net_forward), the rest go layer by layer in a
+// per-thread workspace.
 template <typename T>
 struct DynamicNeuralNet {
-  std::vector<DynamicLayer<T>> layers;
+  // every weight row and bias block starts on its own cache line
+  static constexpr size_t PARAM_ALIGNMENT = 64;
+  using ParamBuffer = std::vector<T, AlignedAllocator<T, PARAM_ALIGNMENT>>;
+  static_assert(!std::is_same_v<T, float> || PARAM_ALIGNMENT / sizeof(T) == gemv::LANES,
+                "weight rows must be whole gemv chunks");
+
+  std::vector<DynamicLayer<T>> layers{};
+
+  DynamicNeuralNet() = default;
+  DynamicNeuralNet(const DynamicNeuralNet &other) : layers(other.layers), params(other.params) {
+    bind_layers();
+  }
+  DynamicNeuralNet &operator=(const DynamicNeuralNet &other) {
+    if (this != &other) {
+      layers = other.layers;
+      params = other.params;
+      bind_layers();
+    }
+    return *this;
+  }
+  // moving the arena keeps its address, the views stay valid
+  DynamicNeuralNet(DynamicNeuralNet &&) = default;
+  DynamicNeuralNet &operator=(DynamicNeuralNet &&) = default;
 
   void init(std::mt19937 &rng, int inputs, int hidden_size, int hidden_count, int outputs) {
     layers.resize(hidden_count + 1);
-    layers[0].init(rng, inputs, hidden_size);
+    layers[0].inputs = inputs;
+    layers[0].outputs = hidden_size;
     for (int i = 1; i < hidden_count; ++i) {
-      layers[i].init(rng, hidden_size, hidden_size);
+      layers[i].inputs = hidden_size;
+      layers[i].outputs = hidden_size;
+    }
+    layers[hidden_count].inputs = hidden_size;
+    layers[hidden_count].outputs = outputs;
+
+    // padding between blocks stays zero
+    params.assign(arena_size(), static_cast<T>(0));
+    bind_layers();
+    for (auto &layer : layers) {
+      layer.init(rng);
     }
-    layers[hidden_count].init(rng, hidden_size, outputs);
   }
 
-  void forward(const T *input, T *output) {
-    // allocate buffers with maximum required size
-    std::vector<T> buffer_a(layers[0].outputs);
-    std::vector<T> buffer_b(layers[0].outputs);
+  void forward(const T *input, T *output) const {
+    if constexpr (std::is_same_v<T, float>) {
+      if (kernel) {
+        kernel(params.data(), input, output);
+        return;
+      }
+    }
+    forward_layers(input, output);
+  }
+
+  // forward one DynamicLayer at a time, what forward does for shapes without a compiled kernel
+  void forward_layers(const T *input, T *output) const {
+    // two buffers of the widest hidden layer, reused by every net on this thread
+    thread_local std::vector<T> workspace{};
+    const size_t width = layers[0].outputs;
+    if (workspace.size() < width * 2) {
+      workspace.resize(width * 2);
+    }
 
     // set up pointers for current and next buffers
-    T *current = buffer_a.data();
-    T *next = buffer_b.data();
+    T *current = workspace.data();
+    T *next = workspace.data() + width;
 
     // forward through input layer
     layers[0].forward(input, current);
 
     // forward through hidden layers
-    for (int i = 1; i < layers.size(); ++i) {
+    for (size_t i = 1; i + 1 < layers.size(); ++i) {
       layers[i].forward(current, next);
       // swap buffers
       std::swap(current, next);
@@ -208,10 +280,27 @@ struct DynamicNeuralNet {
   }
 
   void mutate(std::mt19937 &rng, float mutation_rate) {
-    // mutate all layers
+    // mutate all layers from one fast generator
+    mutation::Rng fast(rng);
     for (auto &layer : layers) {
-      layer.mutate(rng, mutation_rate);
+      layer.mutate(fast, mutation_rate);
+    }
+  }
+
+  uint64_t hash(uint64_t h = PARAM_HASH_SEED) const {
+    for (const auto &layer : layers) {
+      h = layer.hash(h);
     }
+    return h;
+  }
+
+  // every parameter, padding included. the layout only depends on the shape, so these can be
+  // copied straight between nets built with the same init arguments.
+  std::span<const T> get_params() const {
+    return params;
+  }
+  std::span<T> get_params() {
+    return params;
   }
 
   std::string get_shape() {
@@ -224,6 +313,43 @@ struct DynamicNeuralNet {
     }
     return shape;
   }
+
+private:
+  static size_t padded(size_t count) {
+    constexpr size_t per_line = PARAM_ALIGNMENT / sizeof(T);
+    return (count + per_line - 1) / per_line * per_line;
+  }
+
+  size_t arena_size() const {
+    size_t size = 0;
+    for (const auto &layer : layers) {
+      size += padded(layer.outputs) * (layer.inputs + 1);
+    }
+    return size;
+  }
+
+  // point the layer views into params, in layer order, and pick the forward kernel for the shape
+  void bind_layers() {
+    T *next = params.data();
+    for (auto &layer : layers) {
+      layer.stride = static_cast<int>(padded(layer.outputs));
+      layer.weights = next;
+      next += static_cast<size_t>(layer.inputs) * layer.stride;
+      layer.bias = next;
+      next += layer.stride;
+    }
+    if constexpr (std::is_same_v<T, float>) {
+      kernel = layers.size() >= 2 ? gemv::find_net_forward(gemv::get_isa(), layers[0].inputs,
+                                                           layers[0].outputs,
+                                                           static_cast<int>(layers.size() - 1),
+                                                           layers.back().outputs)
+                                  : nullptr;
+    }
+  }
+
+  ParamBuffer params{};
+  // the compiled forward for this shape, when gemv has one. float nets only.
+  gemv::NetForward kernel{nullptr};
 };
 
-} // namespace jnb
+} // namespace model
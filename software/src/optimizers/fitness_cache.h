@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include "param_hash.h"
+
+namespace ga {
+
+// identifies one episode: the evaluated model, its opponent, the seed and the episode length.
+// model hashes come from Model::get_hash.
+struct FitnessKey {
+  uint64_t genome{0};
+  uint64_t opponent{0};
+  uint64_t seed{0};
+  int frame_limit{0};
+
+  bool operator==(const FitnessKey &other) const = default;
+};
+
+struct FitnessKeyHash {
+  size_t operator()(const FitnessKey &key) const {
+    uint64_t h = model::hash_combine(key.genome, key.opponent);
+    h = model::hash_combine(h, key.seed);
+    return model::hash_combine(h, static_cast<uint32_t>(key.frame_limit));
+  }
+};
+
+// episode fitness results shared by all evaluation threads.
+// one cache must only be used with one game (and map), since the game isn't part of the key.
+// the key space is split into shards with their own lock, so threads rarely wait on each other.
+class FitnessCache {
+public:
+  // max_entries bounds memory. a shard that fills up is cleared, which is crude but cheap
+  // and only costs re-evaluations.
+  explicit FitnessCache(size_t max_entries = 1 << 20)
+      : max_shard_entries(max_entries / SHARD_COUNT + 1) {}
+
+  std::optional<int> find(const FitnessKey &key) {
+    auto &shard = get_shard(key);
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto it = shard.entries.find(key);
+      if (it != shard.entries.end()) {
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return it->second;
+      }
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+
+  void insert(const FitnessKey &key, int fitness) {
+    auto &shard = get_shard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.entries.size() >= max_shard_entries) {
+      shard.entries.clear();
+    }
+    shard.entries.insert_or_assign(key, fitness);
+  }
+
+  void clear() {
+    for (auto &shard : shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.entries.clear();
+    }
+    hits = 0;
+    misses = 0;
+  }
+
+  size_t size() {
+    size_t total = 0;
+    for (auto &shard : shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      total += shard.entries.size();
+    }
+    return total;
+  }
+
+  uint64_t get_hits() const {
+    return hits.load(std::memory_order_relaxed);
+  }
+
+  uint64_t get_misses() const {
+    return misses.load(std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr size_t SHARD_COUNT = 64;
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<FitnessKey, int, FitnessKeyHash> entries;
+  };
+
+  Shard &get_shard(const FitnessKey &key) {
+    // the map uses the low bits of the same hash for buckets, so pick the shard by the high bits
+    return shards[(FitnessKeyHash{}(key) >> 58) % SHARD_COUNT];
+  }
+
+  size_t max_shard_entries;
+  std::array<Shard, SHARD_COUNT> shards{};
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+};
+
+} // namespace ga
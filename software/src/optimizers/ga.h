@@ -1,9 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <vector>
 
+#include "genome.h"
 #include "model.h"
 
 using model::Model;
@@ -17,6 +19,9 @@ struct Solution {
   int fitness{0};
   int ref_fitness{0};
   int prior_best_fitness{0};
+  // how model was made, only kept with Config::genome_cache_size set. model is then rebuilt
+  // from it when needed and may be null in between.
+  Genome genome{};
 };
 
 template <typename ObsType>
@@ -42,6 +47,15 @@ using Fitness =
                        std::vector<std::shared_ptr<Model<ObsType>>> &prior_best,
                        const std::vector<uint64_t> &seeds)>;
 
+// evaluates a whole population at once, so the evaluator can share work or spend its budget
+// unevenly between solutions. fitness values must be comparable as if from Fitness.
+template <typename ObsType>
+using PopulationFitness =
+    std::function<void(Population<ObsType> &pop,
+                       std::vector<std::shared_ptr<Model<ObsType>>> &refs,
+                       std::vector<std::shared_ptr<Model<ObsType>>> &prior_best,
+                       const std::vector<uint64_t> &seeds)>;
+
 template <typename ObsType>
 using Logger = std::function<void(size_t current_gen, const Population<ObsType> &pop)>;
 
@@ -56,6 +70,11 @@ struct State {
   int gen{0};
   std::mt19937 rng{};
   std::vector<uint64_t> eval_seeds{};
+  // set with Config::genome_cache_size
+  std::shared_ptr<GenomeDecoder<ObsType>> decoder{nullptr};
+  // models of the last generation that no solution uses anymore. this generation's mutations
+  // copy into them instead of allocating clones.
+  std::vector<std::shared_ptr<Model<ObsType>>> spare_models{};
 };
 
 template <typename ObsType>
@@ -70,13 +89,64 @@ struct Config {
   uint64_t seed{0};
   Populate<ObsType> populate_fun{nullptr};
   Fitness<ObsType> fitness_fun{nullptr};
+  // used instead of fitness_fun when set
+  PopulationFitness<ObsType> population_fitness_fun{nullptr};
   ModelBuilder<ObsType> model_builder{nullptr};
   size_t seeds_per_eval{4};
   SeedChange seed_change{NEVER};
   PriorBestSelect<ObsType> prior_best_select{nullptr};
   Logger<ObsType> fitness_logger{nullptr};
+  // when non-zero, solutions are stored as seed chains (Solution::genome) and their models are
+  // rebuilt on demand, with this many kept in an LRU cache. between generations the population
+  // is then a few bytes per solution instead of a model each.
+  size_t genome_cache_size{0};
 };
 
+// clear state.next, keeping the models nothing else refers to in state.spare_models
+template <typename ObsType>
+void recycle_next(State<ObsType> &state) {
+  std::vector<std::shared_ptr<Model<ObsType>>> old;
+  old.reserve(state.next.size());
+  for (auto &sol : state.next) {
+    if (sol.model) {
+      old.push_back(std::move(sol.model));
+    }
+  }
+  state.next.clear();
+  // a model selected several times is only spare once all its copies are gone
+  std::sort(old.begin(), old.end());
+  old.erase(std::unique(old.begin(), old.end()), old.end());
+  for (auto &model : old) {
+    if (model.use_count() == 1) {
+      state.spare_models.push_back(std::move(model));
+    }
+  }
+}
+
+// copy on write for selection: copies of a solution share its model until one of them is
+// mutated. this gives sol a model of its own, from the spare models if one fits.
+template <typename ObsType>
+void make_private(State<ObsType> &state, Solution<ObsType> &sol) {
+  if (sol.model.use_count() == 1) {
+    return;
+  }
+  while (!state.spare_models.empty()) {
+    auto spare = std::move(state.spare_models.back());
+    state.spare_models.pop_back();
+    if (spare->copy_from(*sol.model)) {
+      sol.model = std::move(spare);
+      return;
+    }
+  }
+  sol.model = sol.model->clone();
+}
+
+// the model of sol, rebuilt from its genome if it isn't held
+template <typename ObsType>
+std::shared_ptr<Model<ObsType>> get_model(State<ObsType> &state, const Solution<ObsType> &sol) {
+  return sol.model ? sol.model : state.decoder->build(sol.genome);
+}
+
 template <typename ObsType>
 void init(State<ObsType> &state, const Config<ObsType> &config) {
   // clear
@@ -86,8 +156,18 @@ void init(State<ObsType> &state, const Config<ObsType> &config) {
   state.rng.seed(config.seed);
 
   // build initial population
-  for (int i = 0; i < config.population_size; ++i) {
-    state.current.emplace_back(Solution{config.model_builder(state.rng), 0});
+  if (config.genome_cache_size > 0) {
+    state.decoder =
+        std::make_shared<GenomeDecoder<ObsType>>(config.model_builder, config.genome_cache_size);
+    for (int i = 0; i < config.population_size; ++i) {
+      Solution<ObsType> sol{};
+      sol.genome.init_seed = state.rng();
+      state.current.push_back(std::move(sol));
+    }
+  } else {
+    for (int i = 0; i < config.population_size; ++i) {
+      state.current.emplace_back(Solution{config.model_builder(state.rng), 0});
+    }
   }
 
   // prior best starts off with random models
@@ -111,16 +191,35 @@ void init(State<ObsType> &state, const Config<ObsType> &config) {
 
 template <typename ObsType>
 void step(State<ObsType> &state, const Config<ObsType> &config) {
+  // rebuild the models of seed chain solutions, mostly one mutate off a cached parent
+  if (state.decoder) {
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < state.current.size(); ++i) {
+      state.current[i].model = get_model(state, state.current[i]);
+    }
+  }
+
   // evaluate the population.
   // this is the most expensive part of the algorithm, which happens to be
   // embarrassingly parallel, so we can use openmp to parallelize the loop.
+  if (config.population_fitness_fun) {
+    // parallelizes internally
+    for (auto &sol : state.current) {
+      sol.fitness = 0;
+      sol.prior_best_fitness = 0;
+      sol.ref_fitness = 0;
+    }
+    config.population_fitness_fun(state.current, state.references, state.prior_best,
+                                  state.eval_seeds);
+  } else {
 #pragma omp parallel for
-  for (int i = 0; i < state.current.size(); ++i) {
-    auto &sol = state.current[i];
-    sol.fitness = 0;
-    sol.prior_best_fitness = 0;
-    sol.ref_fitness = 0;
-    config.fitness_fun(sol, state.references, state.prior_best, state.eval_seeds);
+    for (int i = 0; i < state.current.size(); ++i) {
+      auto &sol = state.current[i];
+      sol.fitness = 0;
+      sol.prior_best_fitness = 0;
+      sol.ref_fitness = 0;
+      config.fitness_fun(sol, state.references, state.prior_best, state.eval_seeds);
+    }
   }
 
   // log fitness
@@ -128,8 +227,8 @@ void step(State<ObsType> &state, const Config<ObsType> &config) {
     config.fitness_logger(state.gen, state.current);
   }
 
-  // create the next population
-  state.next.clear();
+  // create the next population. selected solutions share their parent's model for now.
+  recycle_next(state);
   config.populate_fun(state.current, state.next, state.rng);
 
   // mutate
@@ -140,19 +239,32 @@ void step(State<ObsType> &state, const Config<ObsType> &config) {
     if (config.taper_mutation_rate) {
       mutation_rate *= mutation_ramp_dist(state.rng);
     }
-    state.next[i].model->mutate(state.rng, mutation_rate);
+    if (state.decoder) {
+      // extend the chain, the model is rebuilt next step
+      state.next[i].genome = state.next[i].genome.child(state.rng(), mutation_rate);
+      state.next[i].model = nullptr;
+    } else {
+      make_private(state, state.next[i]);
+      state.next[i].model->mutate(state.rng, mutation_rate);
+    }
   }
+  // spares are only kept for one generation
+  state.spare_models.clear();
 
   // add to prior best
   if (state.gen % config.prior_best_interval == 0) {
     auto best = config.prior_best_select(state.next, state.rng);
     // push best, pop oldest
-    state.prior_best.push_back(best.model);
+    state.prior_best.push_back(get_model(state, best));
     state.prior_best.erase(state.prior_best.begin());
   }
 
   // swap current and next
   std::swap(state.current, state.next);
+  if (state.decoder) {
+    // the evaluated generation's models are left to the cache
+    state.next.clear();
+  }
 
   // increment generation
   ++state.gen;
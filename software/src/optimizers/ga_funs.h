@@ -1,9 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <memory>
+#include <numeric>
 #include <vector>
 
+#include "fitness_cache.h"
 #include "ga.h"
 #include "game.h"
 #include "play.h"
@@ -61,14 +65,41 @@ PriorBestSelect<ObsType> make_tournament_prior_best(size_t size) {
   };
 }
 
+// plays one episode of model against opponent on seed and returns model's fitness. when both
+// hashes are non-zero the result is looked up in / stored to the cache, if there is one.
+template <typename ObsType>
+int play_episode_2p(Game<ObsType> &game, const std::shared_ptr<Model<ObsType>> &model,
+                    uint64_t model_hash, const std::shared_ptr<Model<ObsType>> &opponent,
+                    uint64_t opponent_hash, uint64_t seed, FitnessCache *cache) {
+  const bool cacheable = cache && model_hash != 0 && opponent_hash != 0;
+  const FitnessKey key{model_hash, opponent_hash, seed, game.get_frame_limit()};
+  if (cacheable) {
+    if (auto cached = cache->find(key)) {
+      return *cached;
+    }
+  }
+  game.init(seed);
+  std::vector<std::shared_ptr<model::Model<ObsType>>> models;
+  models.push_back(model);
+  models.push_back(opponent);
+  auto episode_fitness = play(game, models)[0];
+  if (cacheable) {
+    cache->insert(key, episode_fitness);
+  }
+  return episode_fitness;
+}
+
 /**
  * @brief Creates a fitness function for two player games.
  *
  * @param game the game
+ * @param cache optional episode result cache. episodes between two hashable models are looked
+ * up in it before being played, and stored after.
  * @return The constructed fitness function
  */
 template <typename ObsType>
-Fitness<ObsType> make_game_fitness_2p(std::shared_ptr<Game<ObsType>> game) {
+Fitness<ObsType> make_game_fitness_2p(std::shared_ptr<Game<ObsType>> game,
+                                      std::shared_ptr<FitnessCache> cache = nullptr) {
   assert(game->get_player_count() == 2);
   return [=](Solution<ObsType> &sol, std::vector<std::shared_ptr<Model<ObsType>>> &refs,
              std::vector<std::shared_ptr<Model<ObsType>>> &prior_best,
@@ -79,6 +110,7 @@ Fitness<ObsType> make_game_fitness_2p(std::shared_ptr<Game<ObsType>> game) {
 
     // play on a clone of the game to allow this lambda to run in parallel
     auto game_clone = game->clone();
+    const uint64_t genome_hash = cache ? sol.model->get_hash() : 0;
 
     // copy or clone prior best models/ref models depending on if they are stateful
     std::vector<std::shared_ptr<model::Model<ObsType>>> prior_best_clone;
@@ -98,28 +130,193 @@ Fitness<ObsType> make_game_fitness_2p(std::shared_ptr<Game<ObsType>> game) {
       }
     }
 
-    for (auto &opponent : prior_best_clone) {
+    // fitness of sol against opponent over all seeds, from the cache where possible
+    auto play_opponent = [&](const std::shared_ptr<model::Model<ObsType>> &opponent) {
+      const uint64_t opponent_hash = genome_hash != 0 ? opponent->get_hash() : 0;
+      int fitness = 0;
       for (auto seed : seeds) {
-        game_clone->init(seed);
-        std::vector<std::shared_ptr<model::Model<ObsType>>> models;
-        models.push_back(sol.model);
-        models.push_back(opponent);
-        auto episode_fitness = play(*game_clone, models)[0];
-        sol.fitness += episode_fitness;
-        sol.prior_best_fitness += episode_fitness;
+        fitness += play_episode_2p(*game_clone, sol.model, genome_hash, opponent, opponent_hash,
+                                   seed, cache.get());
       }
+      return fitness;
+    };
+
+    for (auto &opponent : prior_best_clone) {
+      auto fitness = play_opponent(opponent);
+      sol.fitness += fitness;
+      sol.prior_best_fitness += fitness;
     }
 
     for (auto &opponent : refs_clone) {
-      for (auto seed : seeds) {
-        game_clone->init(seed);
-        std::vector<std::shared_ptr<model::Model<ObsType>>> models;
-        models.push_back(sol.model);
-        models.push_back(opponent);
-        auto episode_fitness = play(*game_clone, models)[0];
-        sol.fitness += episode_fitness;
-        sol.ref_fitness += episode_fitness;
+      auto fitness = play_opponent(opponent);
+      sol.fitness += fitness;
+      sol.ref_fitness += fitness;
+    }
+  };
+}
+
+// settings for make_game_fitness_2p_racing
+struct RacingConfig {
+  // (opponent, seed) episodes every solution plays before the first cut. doubles every round.
+  size_t initial_episodes{4};
+  // at most this fraction of the remaining solutions is dropped after each round
+  float drop_fraction{0.5f};
+  // how sure a cut has to be, in standard errors of the mean episode fitness. a solution is only
+  // dropped if it is behind the weakest survivor by that margin, so higher values keep the
+  // ranking closer to full evaluation. 0 is plain successive halving.
+  float confidence{1.0f};
+  // dropping stops once this many solutions are left
+  size_t min_survivors{4};
+};
+
+/**
+ * @brief Creates a racing fitness function for two player games.
+ *
+ * Every solution plays the first few (opponent, seed) episodes, the clearly worst ones are
+ * dropped, and the remaining episodes go to the survivors in rounds of growing size. Survivors
+ * end up with the same fitness as from make_game_fitness_2p. Dropped solutions get their mean
+ * episode fitness scaled up to the full episode count, so they still compete in tournaments.
+ *
+ * @param game the game
+ * @param racing when and how much to drop
+ * @param cache optional episode result cache, see make_game_fitness_2p
+ * @return The constructed population fitness function
+ */
+template <typename ObsType>
+PopulationFitness<ObsType>
+make_game_fitness_2p_racing(std::shared_ptr<Game<ObsType>> game, RacingConfig racing = {},
+                            std::shared_ptr<FitnessCache> cache = nullptr) {
+  assert(game->get_player_count() == 2);
+  return [=](Population<ObsType> &pop, std::vector<std::shared_ptr<Model<ObsType>>> &refs,
+             std::vector<std::shared_ptr<Model<ObsType>>> &prior_best,
+             const std::vector<uint64_t> &seeds) {
+    struct Episode {
+      std::shared_ptr<Model<ObsType>> opponent;
+      uint64_t opponent_hash;
+      uint64_t seed;
+      bool is_ref;
+    };
+
+    // alternate between prior best and reference opponents, so every round sees both kinds
+    std::vector<Episode> episodes;
+    for (auto seed : seeds) {
+      for (size_t i = 0; i < std::max(prior_best.size(), refs.size()); ++i) {
+        if (i < prior_best.size()) {
+          episodes.push_back({prior_best[i], 0, seed, false});
+        }
+        if (i < refs.size()) {
+          episodes.push_back({refs[i], 0, seed, true});
+        }
+      }
+    }
+    if (cache) {
+      for (auto &episode : episodes) {
+        episode.opponent_hash = episode.opponent->get_hash();
+      }
+    }
+
+    // running totals per solution
+    struct Tally {
+      int64_t prior_best_sum{0};
+      int64_t ref_sum{0};
+      size_t prior_best_count{0};
+      size_t ref_count{0};
+      double sum_squares{0};
+
+      size_t count() const {
+        return prior_best_count + ref_count;
+      }
+      double mean() const {
+        return count() ? static_cast<double>(prior_best_sum + ref_sum) / count() : 0.0;
+      }
+      double standard_error() const {
+        if (count() == 0) {
+          return 0.0;
+        }
+        const double variance = std::max(0.0, sum_squares / count() - mean() * mean());
+        return std::sqrt(variance / count());
       }
+    };
+    std::vector<Tally> tallies(pop.size());
+
+    std::vector<size_t> survivors(pop.size());
+    std::iota(survivors.begin(), survivors.end(), 0);
+
+    size_t played = 0;
+    size_t round_size = std::max<size_t>(racing.initial_episodes, 1);
+    while (played < episodes.size()) {
+      // once nobody can be dropped anymore, play everything that's left
+      size_t round_end = std::min(episodes.size(), played + round_size);
+      if (survivors.size() <= racing.min_survivors) {
+        round_end = episodes.size();
+      }
+
+#pragma omp parallel for schedule(dynamic)
+      for (int i = 0; i < survivors.size(); ++i) {
+        auto &sol = pop[survivors[i]];
+        auto &tally = tallies[survivors[i]];
+        // play on a clone of the game to allow this loop to run in parallel
+        auto game_clone = game->clone();
+        const uint64_t genome_hash = cache ? sol.model->get_hash() : 0;
+        for (size_t e = played; e < round_end; ++e) {
+          const auto &episode = episodes[e];
+          auto opponent =
+              episode.opponent->is_stateful() ? episode.opponent->clone() : episode.opponent;
+          const int fitness = play_episode_2p(*game_clone, sol.model, genome_hash, opponent,
+                                              episode.opponent_hash, episode.seed, cache.get());
+          if (episode.is_ref) {
+            tally.ref_sum += fitness;
+            ++tally.ref_count;
+          } else {
+            tally.prior_best_sum += fitness;
+            ++tally.prior_best_count;
+          }
+          tally.sum_squares += static_cast<double>(fitness) * fitness;
+        }
+      }
+      played = round_end;
+      round_size *= 2;
+      if (played == episodes.size()) {
+        break;
+      }
+
+      // rank by mean so far (everyone left has played the same episodes), keep the top share
+      // and anyone who is within the confidence margin of the last one kept
+      std::stable_sort(survivors.begin(), survivors.end(), [&](size_t a, size_t b) {
+        return tallies[a].mean() > tallies[b].mean();
+      });
+      const size_t drop_count = std::min(
+          static_cast<size_t>(survivors.size() * racing.drop_fraction), survivors.size() - 1);
+      const size_t keep_count = std::max(racing.min_survivors, survivors.size() - drop_count);
+      if (keep_count >= survivors.size()) {
+        continue;
+      }
+      const auto &last_kept = tallies[survivors[keep_count - 1]];
+      const double threshold = last_kept.mean() - racing.confidence * last_kept.standard_error();
+      std::vector<size_t> next_survivors(survivors.begin(), survivors.begin() + keep_count);
+      for (size_t i = keep_count; i < survivors.size(); ++i) {
+        const auto &tally = tallies[survivors[i]];
+        if (tally.mean() + racing.confidence * tally.standard_error() >= threshold) {
+          next_survivors.push_back(survivors[i]);
+        }
+      }
+      survivors = std::move(next_survivors);
+    }
+
+    // survivors played everything, so their scaling is exact
+    const size_t prior_best_total = prior_best.size() * seeds.size();
+    const size_t ref_total = refs.size() * seeds.size();
+    auto scale = [](int64_t sum, size_t count, size_t total, double fallback_mean) {
+      const double mean = count ? static_cast<double>(sum) / count : fallback_mean;
+      return static_cast<int>(std::lround(mean * total));
+    };
+    for (size_t i = 0; i < pop.size(); ++i) {
+      const auto &tally = tallies[i];
+      auto &sol = pop[i];
+      sol.prior_best_fitness =
+          scale(tally.prior_best_sum, tally.prior_best_count, prior_best_total, tally.mean());
+      sol.ref_fitness = scale(tally.ref_sum, tally.ref_count, ref_total, tally.mean());
+      sol.fitness = sol.prior_best_fitness + sol.ref_fitness;
     }
   };
 }
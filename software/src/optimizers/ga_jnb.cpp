@@ -0,0 +1,174 @@
+#include "ga_jnb.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "jnb_batch.h"
+#include "mlp_simple.h"
+#include "mlp_stack.h"
+
+namespace ga {
+
+namespace {
+
+constexpr size_t ACTION_COUNT = 3; // left, right, jump
+
+using ModelPtr = std::shared_ptr<Model<obs::Simple>>;
+
+// one episode still to be played. models index the list built per evaluation.
+struct Episode {
+  uint32_t solution;
+  uint32_t opponent;
+  uint64_t seed;
+  bool is_ref;
+  int fitness{0};
+};
+
+// everything the episodes of one evaluation share, read-only while batches play
+struct Models {
+  std::vector<ModelPtr> all{};
+  std::vector<uint32_t> stacked{}; // index into stack, or NO_NET
+  std::vector<uint64_t> hashes{};
+  model::StackedMLP stack{};
+};
+
+// plays episodes to the end on one JnBBatch and fills in their fitness
+void play_batch(const std::shared_ptr<const jnb::MapData> &map, int frame_limit,
+                const Models &models, Episode *episodes, size_t count) {
+  jnb::JnBBatch batch(map, count, frame_limit);
+  std::vector<uint64_t> seeds(count);
+  for (size_t i = 0; i < count; ++i) {
+    seeds[i] = episodes[i].seed;
+  }
+  batch.reset(seeds);
+
+  // episodes all last frame_limit frames, so game i plays episode i and nothing else.
+  // rows are [game][player] like the observation batch.
+  std::vector<uint32_t> nets(count * 2);
+  std::vector<ModelPtr> unstacked(count * 2);
+  for (size_t i = 0; i < count; ++i) {
+    assert(batch.get_episode(i) == i);
+    for (size_t p = 0; p < 2; ++p) {
+      const uint32_t m = p == 0 ? episodes[i].solution : episodes[i].opponent;
+      nets[i * 2 + p] = models.stacked[m];
+      if (models.stacked[m] == model::StackedMLP::NO_NET) {
+        unstacked[i * 2 + p] = models.all[m]->is_stateful() ? models.all[m]->clone()
+                                                            : models.all[m];
+      }
+    }
+  }
+
+  jnb::ObservationBatch observations;
+  std::vector<float> actions(count * 2 * ACTION_COUNT);
+  std::vector<float> action(ACTION_COUNT);
+  std::vector<uint8_t> packed(count * 2);
+  while (!batch.is_done()) {
+    batch.observe(observations);
+    models.stack.forward(nets, observations.data(), jnb::SIMPLE_INPUT_COUNT, actions.data(),
+                         ACTION_COUNT);
+    for (size_t row = 0; row < nets.size(); ++row) {
+      if (unstacked[row]) {
+        unstacked[row]->forward_flat(observations.get(row / 2, row % 2), action);
+        std::copy(action.begin(), action.end(), actions.begin() + row * ACTION_COUNT);
+      }
+    }
+
+    // same discretization as JnBGame::update
+    for (size_t row = 0; row < nets.size(); ++row) {
+      const float *a = &actions[row * ACTION_COUNT];
+      packed[(row % 2) * count + row / 2] = jnb::pack_input({a[0] > 0, a[1] > 0, a[2] > 0});
+    }
+    batch.step(packed);
+  }
+
+  const auto &fitness = batch.get_episode_fitness();
+  for (size_t i = 0; i < count; ++i) {
+    episodes[i].fitness = fitness[i];
+  }
+}
+
+} // namespace
+
+PopulationFitness<obs::Simple>
+make_jnb_fitness_2p_batched(std::shared_ptr<const jnb::MapData> map, int frame_limit,
+                            size_t games_per_batch, std::shared_ptr<FitnessCache> cache) {
+  assert(frame_limit > 0 && games_per_batch > 0);
+  return [=](Population<obs::Simple> &pop, std::vector<ModelPtr> &refs,
+             std::vector<ModelPtr> &prior_best, const std::vector<uint64_t> &seeds) {
+    // solutions first, then prior best, then references
+    Models models;
+    for (const auto &sol : pop) {
+      models.all.push_back(sol.model);
+    }
+    const auto prior_best_begin = static_cast<uint32_t>(models.all.size());
+    models.all.insert(models.all.end(), prior_best.begin(), prior_best.end());
+    const auto refs_begin = static_cast<uint32_t>(models.all.size());
+    models.all.insert(models.all.end(), refs.begin(), refs.end());
+
+    models.stacked.assign(models.all.size(), model::StackedMLP::NO_NET);
+    models.hashes.assign(models.all.size(), 0);
+    for (size_t m = 0; m < models.all.size(); ++m) {
+      const auto *mlp = dynamic_cast<const model::SimpleMLP *>(models.all[m].get());
+      if (mlp && models.stack.accepts(mlp->get_net())) {
+        models.stacked[m] = models.stack.add(mlp->get_net());
+      }
+      if (cache) {
+        models.hashes[m] = models.all[m]->get_hash();
+      }
+    }
+
+    // same episodes as make_game_fitness_2p. cached ones are settled right away.
+    std::vector<Episode> episodes;
+    std::vector<Episode> settled;
+    for (uint32_t s = 0; s < pop.size(); ++s) {
+      for (uint32_t o = prior_best_begin; o < models.all.size(); ++o) {
+        for (auto seed : seeds) {
+          Episode episode{s, o, seed, o >= refs_begin};
+          const FitnessKey key{models.hashes[s], models.hashes[o], seed, frame_limit};
+          const bool cacheable = cache && key.genome != 0 && key.opponent != 0;
+          if (cacheable) {
+            if (auto cached = cache->find(key)) {
+              episode.fitness = *cached;
+              settled.push_back(episode);
+              continue;
+            }
+          }
+          episodes.push_back(episode);
+        }
+      }
+    }
+
+    const auto batch_count = static_cast<int64_t>(
+        (episodes.size() + games_per_batch - 1) / games_per_batch);
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t b = 0; b < batch_count; ++b) {
+      const size_t begin = b * games_per_batch;
+      const size_t count = std::min(games_per_batch, episodes.size() - begin);
+      play_batch(map, frame_limit, models, &episodes[begin], count);
+    }
+
+    for (const auto &episode : episodes) {
+      const FitnessKey key{models.hashes[episode.solution], models.hashes[episode.opponent],
+                           episode.seed, frame_limit};
+      if (cache && key.genome != 0 && key.opponent != 0) {
+        cache->insert(key, episode.fitness);
+      }
+    }
+
+    episodes.insert(episodes.end(), settled.begin(), settled.end());
+    for (auto &sol : pop) {
+      sol.fitness = 0;
+      sol.prior_best_fitness = 0;
+      sol.ref_fitness = 0;
+    }
+    for (const auto &episode : episodes) {
+      auto &sol = pop[episode.solution];
+      sol.fitness += episode.fitness;
+      (episode.is_ref ? sol.ref_fitness : sol.prior_best_fitness) += episode.fitness;
+    }
+  };
+}
+
+} // namespace ga
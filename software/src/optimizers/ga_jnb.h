@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "fitness_cache.h"
+#include "ga.h"
+#include "jnb.h"
+#include "observation_types.h"
+
+namespace ga {
+
+/**
+ * @brief Creates a population fitness function for JnB that plays every episode in lockstep.
+ *
+ * Plays the same episodes as make_game_fitness_2p, but groups them into jnb::JnBBatch batches
+ * that are spread over threads. The SimpleMLP solutions and opponents are stacked into one
+ * model::StackedMLP, so a frame of a whole batch needs one StackedMLP::forward call instead of
+ * a virtual forward per player. Other models run one row at a time through
+ * forward_flat, with stateful ones cloned per episode. For stateless models the fitness values
+ * match make_game_fitness_2p.
+ *
+ * @param map the map every episode is played on
+ * @param frame_limit episode length, must be positive
+ * @param games_per_batch games stepped together by one thread
+ * @param cache optional episode result cache, see make_game_fitness_2p
+ * @return The constructed population fitness function
+ */
+PopulationFitness<obs::Simple>
+make_jnb_fitness_2p_batched(std::shared_ptr<const jnb::MapData> map, int frame_limit,
+                            size_t games_per_batch = 256,
+                            std::shared_ptr<FitnessCache> cache = nullptr);
+
+} // namespace ga
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "model.h"
+#include "param_hash.h"
+
+namespace ga {
+
+// one link of a seed chain: model->mutate(std::mt19937(seed), rate)
+struct GenomeMutation {
+  uint32_t seed{0};
+  float rate{0.0f};
+
+  bool operator==(const GenomeMutation &other) const = default;
+};
+
+// a model stored as the seeds that made it: the model builder run on std::mt19937(init_seed),
+// then every mutation in order. that is 8 bytes per generation instead of a parameter copy, and
+// any process with the same builder rebuilds the same parameters from it.
+struct Genome {
+  uint32_t init_seed{0};
+  std::vector<GenomeMutation> mutations{};
+
+  bool operator==(const Genome &other) const = default;
+
+  Genome child(uint32_t seed, float rate) const {
+    Genome result = *this;
+    result.mutations.push_back({seed, rate});
+    return result;
+  }
+
+  // hash of the first length links of the chain, length <= mutations.size()
+  uint64_t hash(size_t length) const {
+    uint64_t h = model::hash_combine(model::PARAM_HASH_SEED, init_seed);
+    for (size_t i = 0; i < length; ++i) {
+      h = link_hash(h, mutations[i]);
+    }
+    return h;
+  }
+
+  uint64_t hash() const {
+    return hash(mutations.size());
+  }
+
+  // hash(length) for every length from 0 to mutations.size(), in one pass
+  std::vector<uint64_t> prefix_hashes() const {
+    std::vector<uint64_t> hashes(mutations.size() + 1);
+    hashes[0] = model::hash_combine(model::PARAM_HASH_SEED, init_seed);
+    for (size_t i = 0; i < mutations.size(); ++i) {
+      hashes[i + 1] = link_hash(hashes[i], mutations[i]);
+    }
+    return hashes;
+  }
+
+  // little endian: init_seed, mutation count, then seed and rate bits of every mutation, all
+  // 32 bit
+  std::vector<uint8_t> encode() const {
+    std::vector<uint8_t> bytes;
+    bytes.reserve(8 + mutations.size() * 8);
+    auto put = [&](uint32_t value) {
+      for (int i = 0; i < 4; ++i) {
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+      }
+    };
+    put(init_seed);
+    put(static_cast<uint32_t>(mutations.size()));
+    for (const auto &mutation : mutations) {
+      put(mutation.seed);
+      put(std::bit_cast<uint32_t>(mutation.rate));
+    }
+    return bytes;
+  }
+
+  // the inverse of encode, nullopt if bytes isn't exactly one encoded genome
+  static std::optional<Genome> decode(std::span<const uint8_t> bytes) {
+    size_t offset = 0;
+    auto get = [&]() {
+      uint32_t value = 0;
+      for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(bytes[offset++]) << (8 * i);
+      }
+      return value;
+    };
+    if (bytes.size() < 8) {
+      return std::nullopt;
+    }
+    Genome genome;
+    genome.init_seed = get();
+    const uint32_t count = get();
+    if (bytes.size() - 8 != static_cast<size_t>(count) * 8) {
+      return std::nullopt;
+    }
+    genome.mutations.resize(count);
+    for (auto &mutation : genome.mutations) {
+      mutation.seed = get();
+      mutation.rate = std::bit_cast<float>(get());
+    }
+    return genome;
+  }
+
+private:
+  static uint64_t link_hash(uint64_t h, const GenomeMutation &mutation) {
+    const uint64_t link =
+        (static_cast<uint64_t>(mutation.seed) << 32) | std::bit_cast<uint32_t>(mutation.rate);
+    return model::hash_combine(h, link);
+  }
+};
+
+// rebuilds models from genomes, keeping the most recently used ones. a child is its parent plus
+// one mutation, so it usually costs one clone and one mutate off the cached parent. safe to use
+// from several threads.
+template <typename ObsType>
+class GenomeDecoder {
+public:
+  using Builder = std::function<std::shared_ptr<model::Model<ObsType>>(std::mt19937 &)>;
+
+  // builder must only depend on the rng it is given, like a ga::ModelBuilder
+  explicit GenomeDecoder(Builder builder, size_t capacity = 256)
+      : builder(std::move(builder)), capacity(capacity) {}
+
+  // the model of genome. the returned model is shared with the cache and other callers, so it
+  // must not be mutated. stateful models are returned as a private clone.
+  std::shared_ptr<model::Model<ObsType>> build(const Genome &genome) {
+    // start from the longest prefix of the chain that is cached
+    const std::vector<uint64_t> prefix = genome.prefix_hashes();
+    std::shared_ptr<model::Model<ObsType>> model{nullptr};
+    size_t done = prefix.size();
+    while (done > 0 && !model) {
+      --done;
+      model = find(prefix[done]);
+    }
+
+    if (model && done == genome.mutations.size()) {
+      hits.fetch_add(1, std::memory_order_relaxed);
+      return model->is_stateful() ? model->clone() : model;
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+    if (model) {
+      model = model->clone();
+    } else {
+      std::mt19937 rng(genome.init_seed);
+      model = builder(rng);
+    }
+    for (size_t i = done; i < genome.mutations.size(); ++i) {
+      std::mt19937 rng(genome.mutations[i].seed);
+      model->mutate(rng, genome.mutations[i].rate);
+    }
+    insert(prefix.back(), model);
+    return model->is_stateful() ? model->clone() : model;
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+  }
+
+  // builds that found the whole chain cached
+  uint64_t get_hits() const {
+    return hits.load(std::memory_order_relaxed);
+  }
+
+  uint64_t get_misses() const {
+    return misses.load(std::memory_order_relaxed);
+  }
+
+private:
+  using Entry = std::pair<uint64_t, std::shared_ptr<model::Model<ObsType>>>;
+
+  std::shared_ptr<model::Model<ObsType>> find(uint64_t key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) {
+      return nullptr;
+    }
+    // move to the front, most recently used
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+  }
+
+  void insert(uint64_t key, std::shared_ptr<model::Model<ObsType>> model) {
+    if (capacity == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it != index.end()) {
+      // another thread built it first
+      entries.splice(entries.begin(), entries, it->second);
+      return;
+    }
+    entries.emplace_front(key, std::move(model));
+    index[key] = entries.begin();
+    if (entries.size() > capacity) {
+      index.erase(entries.back().first);
+      entries.pop_back();
+    }
+  }
+
+  Builder builder;
+  size_t capacity;
+  std::mutex mutex;
+  std::list<Entry> entries{};
+  std::unordered_map<uint64_t, typename std::list<Entry>::iterator> index{};
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+};
+
+} // namespace ga
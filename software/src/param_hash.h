@@ -0,0 +1,43 @@
+// content hashing of model parameters, used to recognise genomes that were already evaluated
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace model {
+
+constexpr uint64_t PARAM_HASH_SEED = 0x9E3779B97F4A7C15;
+
+// splitmix64 finalizer
+constexpr uint64_t hash_mix(uint64_t h) {
+  h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9;
+  h = (h ^ (h >> 27)) * 0x94D049BB133111EB;
+  return h ^ (h >> 31);
+}
+
+constexpr uint64_t hash_combine(uint64_t h, uint64_t value) {
+  return hash_mix(h ^ hash_mix(value));
+}
+
+// hashes the raw bytes, 8 at a time. floats are hashed by their bit pattern, so -0.0 and 0.0
+// give different hashes. that only costs a cache miss.
+inline uint64_t hash_bytes(uint64_t h, const void *data, size_t size) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  h = hash_combine(h, size);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, 8);
+    h = (h ^ word) * 0xFF51AFD7ED558CCD;
+    h ^= h >> 32;
+  }
+  if (i < size) {
+    uint64_t word = 0;
+    std::memcpy(&word, bytes + i, size - i);
+    h = (h ^ word) * 0xFF51AFD7ED558CCD;
+  }
+  return hash_mix(h);
+}
+
+} // namespace model
@@ -10,10 +10,15 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <cstddef>
 #include <cstdint>
 #include <algorithm>
 
 namespace jnb {
+// largest map the PL can hold, see game_types.vhd
+constexpr size_t MAP_MAX_SIZE_BITS = 4;
+constexpr size_t MAP_MAX_SIZE_TILES = 1 << MAP_MAX_SIZE_BITS;
+
 struct TilePos {
   uint8_t x;
   uint8_t y;
@@ -45,10 +50,10 @@ struct TileMap {
   std::vector<TilePos> spawns;
 
   // Constructor that initializes an empty map
-  TileMap() : width(0), height(0) {}
+  constexpr TileMap() : width(0), height(0) {}
 
   // functions for reading the map in y-up ordering
-  Tile read_map(int x, int y) const {
+  constexpr Tile read_map(int x, int y) const {
     if (x < 0 || y < 0 || x >= width)
       return Tile::GROUND;
     if (y >= height)
@@ -56,7 +61,7 @@ struct TileMap {
     return static_cast<Tile>(tiles[height - 1 - y][x]);
   }
 
-  Tile read_base_map(const TilePos &pos) const {
+  constexpr Tile read_base_map(const TilePos &pos) const {
     return read_map(pos.x, pos.y);
   }
 
@@ -1,6 +1,9 @@
 // OpenGL implementation of the PixelGame class
 #include "pixel_game.h"
+#include <chrono>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <tuple>
 
 // Vertex shader source code
@@ -261,7 +264,7 @@ bool PixelGame::create_shader_program() {
 }
 
 void PixelGame::run(std::function<void()> update_func,
-                    std::function<std::pair<int, int>(std::vector<uint32_t> &pixels)> render_func,
+                    RenderFunc render_func,
                     std::function<void(SDL_Event &)> handle_input,
                     std::function<void()> imgui_update_func) {
 
@@ -272,31 +275,12 @@ void PixelGame::run(std::function<void()> update_func,
 
   // Create pixel buffer
   std::vector<uint32_t> pixels;
-  int internal_width = 0;
-  int internal_height = 0;
+  rendering::RenderTarget target;
 
   // Main game loop
   while (running) {
     // Handle events
-    SDL_Event e;
-    while (SDL_PollEvent(&e) != 0) {
-      // Pass events to ImGui
-      ImGui_ImplSDL2_ProcessEvent(&e);
-
-      if (e.type == SDL_QUIT) {
-        running = false;
-      } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE) {
-        running = false;
-      } else if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_RESIZED) {
-        // Handle window resize
-        window_width = e.window.data1;
-        window_height = e.window.data2;
-
-      } else {
-        // Pass other events to the provided input handler
-        handle_input(e);
-      }
-    }
+    poll_events(handle_input);
 
     // Start ImGui frame - ALWAYS do this every frame
     ImGui_ImplOpenGL3_NewFrame();
@@ -318,49 +302,192 @@ void PixelGame::run(std::function<void()> update_func,
       // Update game state
       update_func();
 
-      // Clear the pixel buffer
-      std::fill(pixels.begin(), pixels.end(), 0);
-
-      // Let the game render to the pixel buffer
-      auto [new_internal_width, new_internal_height] = render_func(pixels);
+      // Let the game render to the pixel buffer. it is not cleared first, the previous frame is
+      // left in it so games can redraw just what changed
+      auto [new_internal_width, new_internal_height] = render_func(pixels, target);
 
       // Update the texture with the new pixel data
-      glBindTexture(GL_TEXTURE_2D, texture);
-      // Reallocate texture memory if necessary
-      if (new_internal_width != internal_width || new_internal_height != internal_height) {
-        // Resize the texture if dimensions have changed
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, new_internal_width, new_internal_height, 0, GL_RGBA,
-                     GL_UNSIGNED_BYTE, nullptr);
-        internal_width = new_internal_width;
-        internal_height = new_internal_height;
+      upload_texture(pixels, new_internal_width, new_internal_height);
+    }
+
+    draw_and_swap();
+  }
+}
+
+void PixelGame::run_decoupled(
+    std::function<void()> update_func,
+    RenderFunc render_func,
+    std::function<void(SDL_Event &)> handle_input, std::function<void()> imgui_update_func) {
+
+  if (!running) {
+    std::cerr << "Cannot run game: not initialized properly" << std::endl;
+    return;
+  }
+
+  using Clock = std::chrono::steady_clock;
+  TripleBuffer<Frame> frames;
+  std::atomic<uint64_t> sim_frame_count{0};
+
+  // input events are handed to the simulation thread, so handlers never race with update_func
+  std::mutex event_mutex;
+  std::vector<SDL_Event> pending_events;
+
+  std::thread sim_thread([&]() {
+    std::vector<SDL_Event> events;
+    auto next_update = Clock::now();
+    while (running) {
+      {
+        std::lock_guard<std::mutex> lock(event_mutex);
+        events.swap(pending_events);
+      }
+      for (auto &e : events) {
+        handle_input(e);
+      }
+      events.clear();
+
+      update_func();
+      ++sim_frame_count;
+
+      // past real time there are more updates than the display can show, so only render once
+      // the last published frame has been picked up
+      const bool real_time = !uncapped && sim_speed <= 1.0f;
+      if (real_time || !frames.has_new()) {
+        Frame &frame = frames.back();
+        std::tie(frame.width, frame.height) = render_func(frame.pixels, frame.target);
+        frames.publish();
+      }
+
+      if (uncapped) {
+        next_update = Clock::now();
+        continue;
+      }
+      next_update += std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(1.0 / (target_fps * sim_speed)));
+      // don't try to catch up after falling far behind, e.g. when the speed was just lowered
+      const auto now = Clock::now();
+      if (next_update < now - std::chrono::milliseconds(100)) {
+        next_update = now;
+      }
+      std::this_thread::sleep_until(next_update);
+    }
+  });
+
+  // rates for the overlay, measured over half second windows
+  auto rate_start = Clock::now();
+  uint64_t rate_sim_frames = 0;
+  int rate_render_frames = 0;
+  float sim_rate = 0.0f;
+  float render_rate = 0.0f;
+
+  // Main render loop, paced by vsync
+  while (running) {
+    poll_events([&](SDL_Event &e) {
+      std::lock_guard<std::mutex> lock(event_mutex);
+      pending_events.push_back(e);
+    });
+
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplSDL2_NewFrame();
+    ImGui::NewFrame();
+
+    const double elapsed = std::chrono::duration<double>(Clock::now() - rate_start).count();
+    if (elapsed >= 0.5) {
+      const uint64_t sim_frames = sim_frame_count;
+      sim_rate = static_cast<float>((sim_frames - rate_sim_frames) / elapsed);
+      render_rate = static_cast<float>(rate_render_frames / elapsed);
+      rate_sim_frames = sim_frames;
+      rate_render_frames = 0;
+      rate_start = Clock::now();
+    }
+
+    ImGui::Begin("Simulation");
+    ImGui::Text("Simulation: %.0f frames/sec", sim_rate);
+    ImGui::Text("Render: %.0f frames/sec", render_rate);
+    bool uncapped_value = uncapped;
+    if (ImGui::Checkbox("Uncapped", &uncapped_value)) {
+      uncapped = uncapped_value;
+    }
+    if (!uncapped_value) {
+      float speed = sim_speed;
+      if (ImGui::SliderFloat("Speed", &speed, 0.125f, 64.0f, "%.3gx",
+                             ImGuiSliderFlags_Logarithmic)) {
+        sim_speed = speed;
       }
-      handle_resize(window_width, window_height, internal_width, internal_height);
-      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, internal_width, internal_height, GL_RGBA,
-                      GL_UNSIGNED_BYTE, pixels.data());
     }
+    ImGui::End();
 
-    // Clear the screen
-    glClear(GL_COLOR_BUFFER_BIT);
+    imgui_update_func();
 
-    // Set the viewport to maintain aspect ratio
-    glViewport(viewport_x, viewport_y, viewport_width, viewport_height);
+    if (frames.acquire()) {
+      const Frame &frame = frames.front();
+      upload_texture(frame.pixels, frame.width, frame.height);
+      ++rate_render_frames;
+    }
 
-    // Draw the texture
-    glUseProgram(shader_program);
-    glBindVertexArray(vao);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    draw_and_swap();
+  }
 
-    // Render ImGui
-    ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+  sim_thread.join();
+}
 
-    // Swap buffers
-    SDL_GL_SwapWindow(window);
+void PixelGame::poll_events(const std::function<void(SDL_Event &)> &handle_input) {
+  SDL_Event e;
+  while (SDL_PollEvent(&e) != 0) {
+    // Pass events to ImGui
+    ImGui_ImplSDL2_ProcessEvent(&e);
+
+    if (e.type == SDL_QUIT) {
+      running = false;
+    } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE) {
+      running = false;
+    } else if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_RESIZED) {
+      // Handle window resize
+      window_width = e.window.data1;
+      window_height = e.window.data2;
+
+    } else {
+      // Pass other events to the provided input handler
+      handle_input(e);
+    }
   }
 }
 
+void PixelGame::upload_texture(const std::vector<uint32_t> &pixels, int width, int height) {
+  glBindTexture(GL_TEXTURE_2D, texture);
+  // Reallocate texture memory if necessary
+  if (width != internal_width || height != internal_height) {
+    // Resize the texture if dimensions have changed
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    internal_width = width;
+    internal_height = height;
+  }
+  handle_resize(window_width, window_height, internal_width, internal_height);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, internal_width, internal_height, GL_RGBA,
+                  GL_UNSIGNED_BYTE, pixels.data());
+}
+
+void PixelGame::draw_and_swap() {
+  // Clear the screen
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  // Set the viewport to maintain aspect ratio
+  glViewport(viewport_x, viewport_y, viewport_width, viewport_height);
+
+  // Draw the texture
+  glUseProgram(shader_program);
+  glBindVertexArray(vao);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glDrawArrays(GL_TRIANGLES, 0, 6);
+
+  // Render ImGui
+  ImGui::Render();
+  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+  // Swap buffers
+  SDL_GL_SwapWindow(window);
+}
+
 void PixelGame::handle_resize(int width, int height, int internal_width, int internal_height) {
   // Calculate the aspect ratios
   float window_aspect = (float)width / (float)height;
@@ -2,6 +2,8 @@
 #pragma once
 
 #include <SDL2/SDL.h>
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <functional>
 #include <glad/glad.h>
@@ -11,20 +13,89 @@
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_opengl3.h>
 
+#include "rendering.h"
+
+/**
+ * Lock-free triple buffer for one producer and one consumer thread. The producer always has a
+ * free slot to write into and the consumer always picks up the latest published one.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+  // Producer: the slot to write the next value into
+  T &back() {
+    return slots[back_index];
+  }
+
+  // Producer: hand the back slot to the consumer, replacing any value it hasn't picked up
+  void publish() {
+    back_index = middle.exchange(back_index | NEW_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+  }
+
+  // Either side: whether a published value is waiting for the consumer
+  bool has_new() const {
+    return (middle.load(std::memory_order_acquire) & NEW_BIT) != 0;
+  }
+
+  // Consumer: take the latest published value if there is one, returns whether front() changed
+  bool acquire() {
+    if (!has_new()) {
+      return false;
+    }
+    front_index = middle.exchange(front_index, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+  }
+
+  // Consumer: the value taken by the last successful acquire()
+  const T &front() const {
+    return slots[front_index];
+  }
+
+private:
+  static constexpr uint8_t INDEX_MASK = 0x3;
+  static constexpr uint8_t NEW_BIT = 0x4;
+
+  T slots[3]{};
+  uint8_t back_index{0};
+  uint8_t front_index{1};
+  std::atomic<uint8_t> middle{2};
+};
+
 /**
  * PixelGame class - Handles SDL initialization, game loop, and OpenGL rendering with aspect ratio
  * preservation
  */
 class PixelGame {
+public:
+  // renders into pixels, which holds the frame last rendered with target, and returns its size
+  using RenderFunc = std::function<std::pair<int, int>(std::vector<uint32_t> &pixels,
+                                                       rendering::RenderTarget &target)>;
+
 private:
   SDL_Window *window = nullptr;
   SDL_GLContext gl_context = nullptr; // OpenGL context
-  bool running = false;
+  std::atomic<bool> running = false;
   int target_fps;
   int monitor_refresh_rate = 60; // Default refresh rate
   int frame_repeat_count = 1;    // Number of refreshes per game update
   int current_frame = 0;         // Current frame in the repetition cycle
 
+  // Simulation pacing for run_decoupled, changed from the overlay or the setters
+  std::atomic<float> sim_speed = 1.0f; // multiple of target_fps
+  std::atomic<bool> uncapped = false;  // ignore sim_speed and update as fast as possible
+
+  // Size of the texture the game renders into
+  int internal_width = 0;
+  int internal_height = 0;
+
+  // A rendered frame passed from the simulation thread to the render thread
+  struct Frame {
+    std::vector<uint32_t> pixels{};
+    rendering::RenderTarget target{}; // what was last drawn into pixels
+    int width = 0;
+    int height = 0;
+  };
+
   // Window size tracking
   int window_width = 0;
   int window_height = 0;
@@ -53,6 +124,15 @@ private:
   // Handle window resize
   void handle_resize(int width, int height, int internal_width, int internal_height);
 
+  // Process pending SDL events, passing the ones the window doesn't handle itself to handle_input
+  void poll_events(const std::function<void(SDL_Event &)> &handle_input);
+
+  // Copy a rendered frame into the texture
+  void upload_texture(const std::vector<uint32_t> &pixels, int width, int height);
+
+  // Draw the texture and the ImGui frame, then present
+  void draw_and_swap();
+
 public:
   /**
    * Constructor - Initialize the PixelGame
@@ -74,18 +154,47 @@ public:
    * Run the game loop with provided update, render, and input handling functions
    *
    * @param update_func Function to update game state
-   * @param render_func Function to render game state, takes an array of RGBA pixels
+   * @param render_func Function to render game state, takes an array of RGBA pixels. The same
+   * buffer and render target are passed every frame and the buffer still holds the previous
+   * frame, so it must be fully overwritten or only redrawn where the target says it changed.
    * @param handle_input Function to handle input events, takes SDL_Event
    * @param imgui_update_func Function to update ImGui interface, called every frame
    */
   void run(
       std::function<void()> update_func,
-      std::function<std::pair<int, int>(std::vector<uint32_t> &pixels)> render_func,
+      RenderFunc render_func,
+      std::function<void(SDL_Event &)> handle_input,
+      std::function<void()> imgui_update_func = []() {});
+
+  /**
+   * Like run, but update_func and render_func are called on a separate simulation thread that
+   * runs at sim_speed times the target fps, or as fast as it can when uncapped. The window shows
+   * the latest rendered frame at the display rate, with both rates and the speed controls in an
+   * ImGui overlay. handle_input is also called on the simulation thread, between updates.
+   * imgui_update_func stays on the calling thread, so it must not touch simulation state.
+   */
+  void run_decoupled(
+      std::function<void()> update_func,
+      RenderFunc render_func,
       std::function<void(SDL_Event &)> handle_input,
       std::function<void()> imgui_update_func = []() {});
 
   /**
-   * Stop the game loop
+   * Simulation speed for run_decoupled as a multiple of the target fps
+   */
+  void set_sim_speed(float speed) {
+    sim_speed = speed;
+  }
+
+  /**
+   * Let run_decoupled update as fast as possible, ignoring the speed
+   */
+  void set_uncapped(bool uncapped) {
+    this->uncapped = uncapped;
+  }
+
+  /**
+   * Stop the game loop. Safe to call from update_func in either mode.
    */
   void stop();
 };
@@ -0,0 +1,359 @@
+#include "pl_hw_nn.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+
+#include "cpu_isa.h"
+#include "games/jnb_batch.h"
+
+// same approach as gemv.cpp: one `#pragma omp simd` kernel, compiled again with target
+// attributes on gcc/clang x86 and picked at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PL_HW_X86 1
+#define PL_HW_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define PL_HW_X86 0
+#define PL_HW_ALWAYS_INLINE inline
+#endif
+
+namespace model::pl_hw {
+
+namespace {
+
+constexpr int N = WEIGHTS_PER_NEURON;
+
+// rows per kernel call, one AVX-512 register of int32 per logit
+constexpr int BLOCK = 16;
+
+// the low bits of value as a bits wide signed number, like a vhdl signed that overflowed
+constexpr int wrap(int value, int bits) {
+  const int shift = 32 - bits;
+  return static_cast<int>(static_cast<uint32_t>(value) << shift) >> shift;
+}
+
+// numeric_std's resize of a signed to fewer bits: keeps the sign bit and the low bits - 1 bits
+constexpr int resize(int value, int bits) {
+  const int low = value & ((1 << (bits - 1)) - 1);
+  return value < 0 ? low - (1 << (bits - 1)) : low;
+}
+
+// what weight_mult does with each weight_t, everything but -2..2 zeroes the input
+constexpr int multiplier(int weight) {
+  return weight >= -2 && weight <= 2 ? weight : 0;
+}
+
+// weight_mult, in a post_mult_t one bit wider than the logit
+constexpr int weight_mult(int logit, int weight) {
+  return wrap(logit * multiplier(weight), NEURON_DATA_WIDTH + 1);
+}
+
+// the end of neuron_forward, from the finished sum (bias included) to the logit
+constexpr int to_logit(int sum, bool activate) {
+  if (activate && sum < 0) {
+    sum = 0;
+  }
+  return resize(sum >> SUM_TO_LOGIT_SHIFT, NEURON_DATA_WIDTH);
+}
+
+// rows up to BLOCK rows through every layer. the rows are transposed so every logit is a
+// column of rows, and each neuron sums whole columns.
+PL_HW_ALWAYS_INLINE void forward_block_impl(const BatchNet::Neuron (*neurons)[N],
+                                            const int16_t *inputs, int16_t *outputs,
+                                            size_t rows) {
+  // x, 2x, -x and -2x of every logit, in the column order of BatchNet::Neuron
+  alignas(64) int32_t columns[4 * N][BLOCK];
+  alignas(64) int32_t logits[N][BLOCK];
+
+  // rows past the end are zeros, their outputs are dropped
+  for (int i = 0; i < N; ++i) {
+    for (int r = 0; r < BLOCK; ++r) {
+      logits[i][r] = r < static_cast<int>(rows) ? inputs[r * N + i] : 0;
+    }
+  }
+
+  for (int l = 0; l < LAYER_COUNT; ++l) {
+    for (int i = 0; i < N; ++i) {
+#pragma omp simd
+      for (int r = 0; r < BLOCK; ++r) {
+        const int32_t x = logits[i][r];
+        columns[i][r] = x;
+        columns[N + i][r] = 2 * x;
+        columns[2 * N + i][r] = -x;
+        // the only product that overflows post_mult_t: -2 * -2048
+        columns[3 * N + i][r] = wrap(-2 * x, NEURON_DATA_WIDTH + 1);
+      }
+    }
+
+    const bool activate = l + 1 < LAYER_COUNT;
+    for (int n = 0; n < N; ++n) {
+      const auto &neuron = neurons[l][n];
+      int32_t sum[BLOCK];
+#pragma omp simd
+      for (int r = 0; r < BLOCK; ++r) {
+        sum[r] = neuron.bias;
+      }
+      for (int k = 0; k < neuron.count; ++k) {
+        const int32_t *column = columns[neuron.columns[k]];
+#pragma omp simd
+        for (int r = 0; r < BLOCK; ++r) {
+          sum[r] += column[r];
+        }
+      }
+#pragma omp simd
+      for (int r = 0; r < BLOCK; ++r) {
+        logits[n][r] = to_logit(sum[r], activate);
+      }
+    }
+  }
+
+  for (size_t r = 0; r < rows; ++r) {
+    for (int i = 0; i < N; ++i) {
+      outputs[r * N + i] = static_cast<int16_t>(logits[i][r]);
+    }
+  }
+}
+
+void forward_block_generic(const BatchNet::Neuron (*neurons)[N], const int16_t *inputs,
+                           int16_t *outputs, size_t rows) {
+  forward_block_impl(neurons, inputs, outputs, rows);
+}
+
+#if PL_HW_X86
+__attribute__((target("avx2"))) void forward_block_avx2(const BatchNet::Neuron (*neurons)[N],
+                                                        const int16_t *inputs, int16_t *outputs,
+                                                        size_t rows) {
+  forward_block_impl(neurons, inputs, outputs, rows);
+}
+
+__attribute__((target("avx512f"))) void
+forward_block_avx512(const BatchNet::Neuron (*neurons)[N], const int16_t *inputs,
+                     int16_t *outputs, size_t rows) {
+  forward_block_impl(neurons, inputs, outputs, rows);
+}
+#endif
+
+// episodes all last frame_limit frames, so game i plays matchup i and nothing else
+void play_batch(const std::shared_ptr<const jnb::MapData> &map, int frame_limit,
+                const std::vector<BatchNet> &nets, const Matchup *matchups, size_t count,
+                int32_t *fitness) {
+  jnb::JnBBatch batch(map, count, frame_limit);
+  std::vector<uint64_t> seeds(count);
+  for (size_t i = 0; i < count; ++i) {
+    seeds[i] = matchups[i].seed;
+  }
+  batch.reset(seeds);
+
+  // rows are [game][player]. they are observed into slots sorted by net, so every net runs
+  // all of its rows in one call.
+  const size_t rows = count * 2;
+  std::vector<uint32_t> row_net(rows);
+  for (size_t i = 0; i < count; ++i) {
+    assert(batch.get_episode(i) == i);
+    row_net[i * 2] = matchups[i].p1;
+    row_net[i * 2 + 1] = matchups[i].p2;
+  }
+  std::vector<uint32_t> order(rows);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](uint32_t a, uint32_t b) { return row_net[a] < row_net[b]; });
+  std::vector<uint32_t> slot(rows);
+  for (size_t k = 0; k < rows; ++k) {
+    slot[order[k]] = static_cast<uint32_t>(k);
+  }
+
+  std::vector<int16_t> inputs(rows * N);
+  std::vector<int16_t> outputs(rows * N);
+  std::vector<uint8_t> packed(rows);
+  jnb::GameState state;
+  while (!batch.is_done()) {
+    for (size_t i = 0; i < count; ++i) {
+      batch.load(i, state);
+      observe(state, true, &inputs[slot[i * 2] * N]);
+      observe(state, false, &inputs[slot[i * 2 + 1] * N]);
+    }
+    for (size_t begin = 0; begin < rows;) {
+      size_t end = begin + 1;
+      while (end < rows && row_net[order[end]] == row_net[order[begin]]) {
+        ++end;
+      }
+      nets[row_net[order[begin]]].forward(&inputs[begin * N], &outputs[begin * N], end - begin);
+      begin = end;
+    }
+    for (size_t row = 0; row < rows; ++row) {
+      packed[(row % 2) * count + row / 2] = jnb::pack_input(to_input(&outputs[slot[row] * N]));
+    }
+    batch.step(packed);
+  }
+
+  const auto &episode_fitness = batch.get_episode_fitness();
+  std::copy_n(episode_fitness.begin(), count, fitness);
+}
+
+} // namespace
+
+void Net::decode(uint8_t param, int param_index) {
+  if (param_index < 0) {
+    return;
+  }
+  const int neuron_mask = N - 1;
+  const int layer_mask = LAYER_COUNT - 1;
+  if (param_index < TOTAL_WEIGHTS) {
+    // the address is {layer, neuron, weight}, low bits last
+    const int weight = param_index & neuron_mask;
+    const int neuron = (param_index >> WEIGHTS_PER_NEURON_EXP) & neuron_mask;
+    const int layer = (param_index >> (2 * WEIGHTS_PER_NEURON_EXP)) & layer_mask;
+    weights[layer][neuron][weight] = static_cast<int8_t>(wrap(param, WEIGHT_BITS));
+  } else if (param_index < TOTAL_PARAMS) {
+    // {layer, neuron}. like the vhdl, taken from the address itself rather than the address
+    // minus TOTAL_WEIGHTS, which is the same while TOTAL_WEIGHTS is a power of two.
+    const int neuron = param_index & neuron_mask;
+    const int layer = (param_index >> WEIGHTS_PER_NEURON_EXP) & layer_mask;
+    bias[layer][neuron] = static_cast<int8_t>(wrap(param, BIAS_BITS));
+  }
+}
+
+void Net::load_bram(std::span<const uint8_t> bram) {
+  const int size = static_cast<int>(std::min(bram.size(), static_cast<size_t>(BRAM_DEPTH)));
+  for (int i = 0; i < size; ++i) {
+    decode(bram[i], i);
+  }
+}
+
+bool Net::load_bram_file(const std::string &filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file) {
+    std::cerr << "Failed to open " << filename << std::endl;
+    return false;
+  }
+  const std::vector<uint8_t> bram(std::istreambuf_iterator<char>(file), {});
+  if (bram.size() < static_cast<size_t>(TOTAL_PARAMS)) {
+    std::cerr << filename << " holds " << bram.size() << " parameters, the net needs "
+              << TOTAL_PARAMS << std::endl;
+    return false;
+  }
+  load_bram(bram);
+  return true;
+}
+
+void Net::forward(const int16_t *input, int16_t *output) const {
+  int16_t current[N];
+  std::copy_n(input, N, current);
+  for (int l = 0; l < LAYER_COUNT; ++l) {
+    const bool activate = l + 1 < LAYER_COUNT;
+    int16_t next[N];
+    for (int n = 0; n < N; ++n) {
+      int sum = 0;
+      for (int i = 0; i < N; ++i) {
+        sum += weight_mult(current[i], weights[l][n][i]);
+      }
+      next[n] = static_cast<int16_t>(to_logit(sum + bias[l][n], activate));
+    }
+    std::copy_n(next, N, current);
+  }
+  std::copy_n(current, N, output);
+}
+
+void observe(const jnb::GameState &state, bool p1_perspective, int16_t *observation) {
+  auto logit = [](int value) { return static_cast<int16_t>(wrap(value, NEURON_DATA_WIDTH)); };
+  // to_signed(pos, 12, fixed_wrap, fixed_truncate): whole pixels, wrapped
+  auto position = [&](jnb::F4 value) { return logit(value.to_integer_floor()); };
+  // resize(signed(to_slv(vel)), 12) of the raw fixed point value
+  auto velocity = [](jnb::F4 value) {
+    return static_cast<int16_t>(resize(value.raw_value(), NEURON_DATA_WIDTH));
+  };
+  auto flag = [](bool value) { return static_cast<int16_t>(value ? 32 : -32); };
+
+  const auto &first = p1_perspective ? state.p1 : state.p2;
+  const auto &second = p1_perspective ? state.p2 : state.p1;
+  const int16_t coin_x = logit(state.coin_pos.x << 3); // TILE_PX_BITS
+  const int16_t coin_y = logit(state.coin_pos.y << 3);
+
+  std::fill_n(observation, N, 0);
+  int index = 0;
+  observation[index++] = coin_x;
+  observation[index++] = coin_y;
+  observation[index++] = position(first.x);
+  observation[index++] = position(first.y);
+  observation[index++] = velocity(first.x_vel);
+  observation[index++] = velocity(first.y_vel);
+  observation[index++] = flag(first.dead_timeout == 0);
+  observation[index++] = position(second.x);
+  observation[index++] = position(second.y);
+  observation[index++] = velocity(second.x_vel);
+  observation[index++] = velocity(second.y_vel);
+  observation[index++] = flag(second.dead_timeout == 0);
+  // deltas
+  observation[index++] = flag(position(first.x) < position(second.x));
+  observation[index++] = flag(position(first.y) < position(second.y));
+  observation[index++] = flag(position(first.x) < coin_x);
+  observation[index++] = flag(position(first.y) < coin_y);
+}
+
+BatchNet::BatchNet(const Net &net) {
+  constexpr int GROUP_MULTIPLIERS[4] = {1, 2, -1, -2};
+  for (int l = 0; l < LAYER_COUNT; ++l) {
+    for (int n = 0; n < N; ++n) {
+      auto &neuron = neurons[l][n];
+      neuron.count = 0;
+      neuron.bias = net.bias[l][n];
+      for (int g = 0; g < 4; ++g) {
+        for (int i = 0; i < N; ++i) {
+          if (multiplier(net.weights[l][n][i]) == GROUP_MULTIPLIERS[g]) {
+            neuron.columns[neuron.count++] = static_cast<uint8_t>(g * N + i);
+          }
+        }
+      }
+    }
+  }
+}
+
+// SCALAR runs the same kernel compiled for the baseline target
+void BatchNet::forward(const int16_t *inputs, int16_t *outputs, size_t count) const {
+  static const cpu::Isa isa = cpu::detect_isa();
+  for (size_t begin = 0; begin < count; begin += BLOCK) {
+    const size_t rows = std::min(count - begin, static_cast<size_t>(BLOCK));
+    const int16_t *in = inputs + begin * N;
+    int16_t *out = outputs + begin * N;
+    switch (isa) {
+#if PL_HW_X86
+      case cpu::Isa::AVX512:
+        forward_block_avx512(neurons, in, out, rows);
+        break;
+      case cpu::Isa::AVX2:
+        forward_block_avx2(neurons, in, out, rows);
+        break;
+#endif
+      default:
+        forward_block_generic(neurons, in, out, rows);
+        break;
+    }
+  }
+}
+
+std::vector<int32_t> play(std::shared_ptr<const jnb::MapData> map, std::span<const Net> nets,
+                          std::span<const Matchup> matchups, int frame_limit,
+                          size_t games_per_batch) {
+  assert(frame_limit > 0 && games_per_batch > 0);
+  std::vector<BatchNet> compiled;
+  compiled.reserve(nets.size());
+  for (const auto &net : nets) {
+    compiled.emplace_back(net);
+  }
+
+  std::vector<int32_t> fitness(matchups.size());
+  const auto batch_count =
+      static_cast<int64_t>((matchups.size() + games_per_batch - 1) / games_per_batch);
+#pragma omp parallel for schedule(dynamic)
+  for (int64_t b = 0; b < batch_count; ++b) {
+    const size_t begin = b * games_per_batch;
+    const size_t count = std::min(games_per_batch, matchups.size() - begin);
+    play_batch(map, frame_limit, compiled, &matchups[begin], count, &fitness[begin]);
+  }
+  return fitness;
+}
+
+} // namespace model::pl_hw
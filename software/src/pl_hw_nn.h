@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "games/jnb.h"
+
+// a bit-exact CPU emulator of the network in fpga/src/neural_network, for replaying and
+// evaluating nets trained on the PL. this is not StaticPLNet: the hardware has 4 layers of 32
+// neurons, 3 bit weights that only mean -2..2, unscaled 4 bit biases and its own observation.
+namespace model::pl_hw {
+
+// nn_types.vhd
+constexpr int WEIGHT_BITS = 3;
+constexpr int BIAS_BITS = 4;
+constexpr int NEURON_DATA_WIDTH = 12;
+constexpr int WEIGHTS_PER_NEURON_EXP = 5;
+constexpr int WEIGHTS_PER_NEURON = 1 << WEIGHTS_PER_NEURON_EXP;
+constexpr int LAYER_COUNT_EXP = 2;
+constexpr int LAYER_COUNT = 1 << LAYER_COUNT_EXP;
+constexpr int TOTAL_WEIGHTS = WEIGHTS_PER_NEURON * WEIGHTS_PER_NEURON * LAYER_COUNT;
+constexpr int TOTAL_BIAS = LAYER_COUNT * WEIGHTS_PER_NEURON;
+constexpr int TOTAL_PARAMS = TOTAL_WEIGHTS + TOTAL_BIAS;
+
+// neuron_forward's sum is wide enough to never overflow, then shifted down to a logit
+constexpr int SUM_WIDTH = 2 + NEURON_DATA_WIDTH + WEIGHTS_PER_NEURON_EXP;
+constexpr int SUM_TO_LOGIT_SHIFT = SUM_WIDTH - NEURON_DATA_WIDTH - 5;
+
+// bram_types.vhd, one 4 bit parameter per address. dumps (SEND_BRAM_MSG, bram_*.dat) hold one
+// address per byte, in address order.
+constexpr int BRAM_DEPTH = 4608;
+
+// the parameters of one net, as the registers in nn.vhd hold them
+struct Net {
+  int8_t weights[LAYER_COUNT][WEIGHTS_PER_NEURON][WEIGHTS_PER_NEURON]{}; // [layer][neuron][input]
+  int8_t bias[LAYER_COUNT][WEIGHTS_PER_NEURON]{};
+
+  // place the parameter at BRAM address param_index, like decode_address in decoder_funs.vhd.
+  // only the low 4 bits of param are used, addresses past TOTAL_PARAMS are ignored.
+  void decode(uint8_t param, int param_index);
+
+  // decode a whole dump, address 0 first
+  void load_bram(std::span<const uint8_t> bram);
+
+  // load a dump written by the BRAM dump button, prints why on failure
+  bool load_bram_file(const std::string &filename);
+
+  // one inference like nn.vhd's main_proc: every layer activates but the last. input and output
+  // are WEIGHTS_PER_NEURON logits. the reference, one neuron at a time.
+  void forward(const int16_t *input, int16_t *output) const;
+};
+
+// observe_state in nn.vhd, WEIGHTS_PER_NEURON logits
+void observe(const jnb::GameState &state, bool p1_perspective, int16_t *observation);
+
+// nn.vhd's action wiring, a separate output per button
+inline jnb::PlayerInput to_input(const int16_t *output) {
+  return {output[0] > 0, output[1] > 0, output[2] > 0};
+}
+
+// a Net compiled for running many rows at once. every neuron's inputs are grouped by
+// multiplier, so a layer is a few sums of whole input columns with no multiplies, and zero
+// weights cost nothing. gives the same outputs as Net::forward.
+class BatchNet {
+public:
+  explicit BatchNet(const Net &net);
+
+  // outputs[row] = net(inputs[row]) for count rows of WEIGHTS_PER_NEURON values each
+  void forward(const int16_t *inputs, int16_t *outputs, size_t count) const;
+
+  // the nonzero terms of one neuron. a layer's input i times multiplier m is column
+  // i + WEIGHTS_PER_NEURON * {1: 0, 2: 1, -1: 2, -2: 3}.
+  struct Neuron {
+    uint8_t columns[WEIGHTS_PER_NEURON];
+    int32_t count;
+    int32_t bias;
+  };
+
+private:
+  Neuron neurons[LAYER_COUNT][WEIGHTS_PER_NEURON];
+};
+
+// one episode between two nets, p1 is the one being scored
+struct Matchup {
+  uint32_t p1;
+  uint32_t p2;
+  uint64_t seed;
+};
+
+// play every matchup for frame_limit frames on JnBBatch games, spread over the omp threads, and
+// return the p1 fitness of each. nets are indexed by the matchups.
+std::vector<int32_t> play(std::shared_ptr<const jnb::MapData> map, std::span<const Net> nets,
+                          std::span<const Matchup> matchups, int frame_limit,
+                          size_t games_per_batch = 256);
+
+} // namespace model::pl_hw
@@ -1,56 +1,143 @@
 #include "pl_nn.h"
 
+#include "cpu_isa.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PL_NN_X86 1
+#include <immintrin.h>
+#else
+#define PL_NN_X86 0
+#endif
+
 namespace model {
-p_t mutate_param(p_t param, std::mt19937 &rng, float mutation_rate, bool is_bias) {
-  std::uniform_real_distribution mutation_chance(0.0f, 1.0f);
-  std::uniform_int_distribution<int> mutation_type(0, 7);
-  if (mutation_chance(rng) < mutation_rate) {
-    auto type = mutation_type(rng);
-    switch (type) {
-      case 0:
-        param -= 1;
-        break;
-      case 1:
-        param += 1;
-        break;
-      case 2:
-        param -= 2;
-        break;
-      case 3:
-        param += 2;
-        break;
-      case 4:
-        param -= 3;
-        break;
-      case 5:
-        param += 3;
-        break;
-      case 6:
-        param -= 4;
-        break;
-      case 7:
-        param += 4;
-        break;
-      default:
-        break; // do nothing
+
+namespace {
+
+// rows and remainders the wide kernel doesn't cover. the compiler vectorizes this, but without
+// pmaddwd.
+void layer_sums_generic(const p_t *weights, const p_t *bias, int inputs, int outputs,
+                        const int16_t *input, int *sums, int input_begin = 0) {
+  for (int i = 0; i < outputs; ++i) {
+    const p_t *row = weights + i * inputs;
+    int sum = 0;
+#pragma omp simd reduction(+ : sum)
+    for (int j = input_begin; j < inputs; ++j) {
+      sum += static_cast<int16_t>(row[j]) * input[j];
     }
+    sums[i] = input_begin == 0 ? bias[i] * 32 + sum : sums[i] + sum;
+  }
+}
 
-    // clamping is different for weight/bias
-    if (is_bias) {
-      // bias is clamped to [-7, 7]
-      if (param < -7) {
-        param = -7;
-      } else if (param > 7) {
-        param = 7;
-      }
-    } else {
-      // weight is clamped to [-2, 2]
-      if (param < -2) {
-        param = -2;
-      } else if (param > 2) {
-        param = 2;
+#if PL_NN_X86
+// 8 outputs at a time: weights are sign extended to int16 and multiplied into pairwise int32 sums
+// with pmaddwd, 16 inputs per instruction. the 8 accumulators are then reduced into one vector.
+__attribute__((target("avx2"))) void layer_sums_avx2(const p_t *weights, const p_t *bias,
+                                                     int inputs, int outputs,
+                                                     const int16_t *input, int *sums) {
+  const int wide_inputs = inputs & ~15;
+  int o = 0;
+  for (; o + 8 <= outputs; o += 8) {
+    // unrolled so the accumulators stay in registers
+    __m256i acc[8];
+#pragma GCC unroll 8
+    for (auto &a : acc) {
+      a = _mm256_setzero_si256();
+    }
+    for (int j = 0; j < wide_inputs; j += 16) {
+      const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + j));
+#pragma GCC unroll 8
+      for (int r = 0; r < 8; ++r) {
+        const __m128i w8 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + (o + r) * inputs + j));
+        acc[r] = _mm256_add_epi32(acc[r], _mm256_madd_epi16(_mm256_cvtepi8_epi16(w8), x));
       }
     }
+
+    // horizontal sums of all 8, lane r of the result belongs to output o + r
+    const __m256i h01 = _mm256_hadd_epi32(acc[0], acc[1]);
+    const __m256i h23 = _mm256_hadd_epi32(acc[2], acc[3]);
+    const __m256i h45 = _mm256_hadd_epi32(acc[4], acc[5]);
+    const __m256i h67 = _mm256_hadd_epi32(acc[6], acc[7]);
+    const __m256i h0123 = _mm256_hadd_epi32(h01, h23);
+    const __m256i h4567 = _mm256_hadd_epi32(h45, h67);
+    __m256i total = _mm256_add_epi32(_mm256_permute2x128_si256(h0123, h4567, 0x20),
+                                     _mm256_permute2x128_si256(h0123, h4567, 0x31));
+    const __m128i b8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(bias + o));
+    total = _mm256_add_epi32(total, _mm256_slli_epi32(_mm256_cvtepi8_epi32(b8), 5));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(sums + o), total);
+
+    if (wide_inputs < inputs) {
+      layer_sums_generic(weights + o * inputs, bias + o, inputs, 8, input, sums + o,
+                         wide_inputs);
+    }
+  }
+  if (o < outputs) {
+    layer_sums_generic(weights + o * inputs, bias + o, inputs, outputs - o, input, sums + o);
+  }
+}
+#endif
+
+} // namespace
+
+void pl_layer_sums(const p_t *weights, const p_t *bias, int inputs, int outputs,
+                   const int16_t *input, int *sums) {
+#if PL_NN_X86
+  // AVX-512 machines run the AVX2 kernel too. rows are only 32 inputs, two 256 bit pmaddwd, so
+  // wider registers would mostly add reduction work.
+  static const bool wide = cpu::detect_isa() != cpu::Isa::SCALAR;
+  if (wide) {
+    layer_sums_avx2(weights, bias, inputs, outputs, input, sums);
+    return;
+  }
+#endif
+  layer_sums_generic(weights, bias, inputs, outputs, input, sums);
+}
+p_t mutate_param(p_t param, mutation::Rng &rng, bool is_bias) {
+  auto type = rng.below(8);
+  switch (type) {
+    case 0:
+      param -= 1;
+      break;
+    case 1:
+      param += 1;
+      break;
+    case 2:
+      param -= 2;
+      break;
+    case 3:
+      param += 2;
+      break;
+    case 4:
+      param -= 3;
+      break;
+    case 5:
+      param += 3;
+      break;
+    case 6:
+      param -= 4;
+      break;
+    case 7:
+      param += 4;
+      break;
+    default:
+      break; // do nothing
+  }
+
+  // clamping is different for weight/bias
+  if (is_bias) {
+    // bias is clamped to [-7, 7]
+    if (param < -7) {
+      param = -7;
+    } else if (param > 7) {
+      param = 7;
+    }
+  } else {
+    // weight is clamped to [-2, 2]
+    if (param < -2) {
+      param = -2;
+    } else if (param > 2) {
+      param = 2;
+    }
   }
 
   return param;
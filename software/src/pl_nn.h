@@ -7,71 +7,108 @@
 #include <cstdint>
 #include <iostream>
 
+#include "mutation.h"
+#include "param_hash.h"
+
 namespace model {
 
 using p_t = std::int8_t;
 
-p_t mutate_param(p_t param, std::mt19937 &rng, float mutation_rate, bool is_bias);
+// param stepped by one of +-1..4, clamped to the bias or weight range
+p_t mutate_param(p_t param, mutation::Rng &rng, bool is_bias);
 int compute_sum_abs_activation(int *inputs, int input_count);
 
+// bias * 32 + weights . input for every output of a layer, with weights row-major
+// [outputs][inputs]. input must fit in int16. runs the widest kernel the cpu has, the sums are
+// exact either way.
+void pl_layer_sums(const p_t *weights, const p_t *bias, int inputs, int outputs,
+                   const int16_t *input, int *sums);
+
+// round(log2(n)) for n > 0
+constexpr int round_log2(int n) {
+  // log2(n) rounds up to k + 1 once n > 2^(k + 0.5), i.e. n^2 > 2^(2k + 1)
+  int k = 0;
+  while ((int64_t{1} << (2 * k + 1)) < int64_t{n} * n) {
+    ++k;
+  }
+  return k;
+}
+
 template <int inputs, int outputs> struct StaticPLLayer {
   p_t weights[outputs][inputs];
   p_t bias[outputs];
 
-  void mutate(std::mt19937 &rng, float mutation_rate) {
-    // loop through each weight
-    for (int i = 0; i < outputs; ++i) {
-      for (int j = 0; j < inputs; ++j) {
-        weights[i][j] = mutate_param(weights[i][j], rng, mutation_rate, false);
-      }
-    }
+  // each parameter changes with probability mutation_rate. only the chosen ones draw random
+  // numbers, see mutation::for_each_selected.
+  void mutate(mutation::Rng &rng, float mutation_rate) {
+    p_t *flat_weights = &weights[0][0];
+    mutation::for_each_selected(rng, outputs * inputs, mutation_rate, [&](size_t i) {
+      flat_weights[i] = mutate_param(flat_weights[i], rng, false);
+    });
+    mutation::for_each_selected(rng, outputs, mutation_rate,
+                                [&](size_t i) { bias[i] = mutate_param(bias[i], rng, true); });
+  }
 
-    // loop through each bias
-    for (int i = 0; i < outputs; ++i) {
-      bias[i] = mutate_param(bias[i], rng, mutation_rate, true);
-    }
+  void init(mutation::Rng &rng) {
+    // every parameter is one mutation away from zero
+    std::fill_n(&weights[0][0], outputs * inputs, p_t{0});
+    std::fill_n(bias, outputs, p_t{0});
+    mutate(rng, 1.0f);
   }
 
-  void init(std::mt19937 &rng) {
-    // loop through each weight
-    for (int i = 0; i < outputs; ++i) {
-      for (int j = 0; j < inputs; ++j) {
-        weights[i][j] = mutate_param(0, rng, 1.0f, false);
-      }
+  uint64_t hash(uint64_t h = PARAM_HASH_SEED) const {
+    h = hash_bytes(h, weights, sizeof(weights));
+    return hash_bytes(h, bias, sizeof(bias));
+  }
+
+  // fixed point format of nn.vhd: sums are shifted back down to NEURON_DATA_WIDTH bit
+  // sign-magnitude activations
+  static constexpr int WEIGHTS_PER_NEURON_EXP = round_log2(outputs);
+  static constexpr int NEURON_DATA_WIDTH = 12;
+  static constexpr int SUM_TO_LOGIC_SHIFT = 2 + WEIGHTS_PER_NEURON_EXP - 5;
+  static constexpr int NEURON_MASK = (1 << NEURON_DATA_WIDTH) - 1;
+  static_assert(SUM_TO_LOGIC_SHIFT >= 0, "layers need at least 8 outputs");
+
+  void forward(int *input, int *output, bool activate = true) {
+    // activations are 12 bit, so only raw observations can be too wide for the int16 kernel
+    int16_t packed[inputs];
+    bool fits = true;
+    for (int j = 0; j < inputs; ++j) {
+      fits &= input[j] >= INT16_MIN && input[j] <= INT16_MAX;
+      packed[j] = static_cast<int16_t>(input[j]);
     }
-    // loop through each bias
-    for (int i = 0; i < outputs; ++i) {
-      bias[i] = mutate_param(0, rng, 1.0f, true);
+    if (fits) {
+      pl_layer_sums(&weights[0][0], bias, inputs, outputs, packed, output);
+    } else {
+      sums_scalar(input, output);
     }
+    to_activations(output, activate);
   }
 
-  void forward(int *input, int *output, bool activate = true) {
+  // reference path, one multiply at a time in int
+  void forward_scalar(int *input, int *output, bool activate = true) {
+    sums_scalar(input, output);
+    to_activations(output, activate);
+  }
+
+private:
+  void sums_scalar(const int *input, int *output) const {
     for (int i = 0; i < outputs; ++i) {
       output[i] = bias[i] * 32;
       for (int j = 0; j < inputs; ++j) {
         output[i] += weights[i][j] * input[j];
       }
-      // activation function (ReLU)
-      if (activate)
-        output[i] = std::max(static_cast<int>(0), output[i]);
     }
+  }
 
-    const int WEIGHTS_PER_NEURON_EXP = (int)round(std::log2((float)outputs));
-    constexpr int NEURON_DATA_WIDTH = 12;
-    const int SUM_TO_LOGIC_SHIFT = 2 + WEIGHTS_PER_NEURON_EXP - 5;
-
-    // make mask based on NEURON_DATA_WIDTH
-    int mask = (1 << NEURON_DATA_WIDTH) - 1;
-
-    // arithmetic shift outputs to the right
+  static void to_activations(int *output, bool activate) {
+#pragma omp simd
     for (int i = 0; i < outputs; ++i) {
-      output[i] = (output[i] >> SUM_TO_LOGIC_SHIFT);
-      bool positive = output[i] >= 0;
-      int positive_ver = positive ? output[i] : -output[i];
-      // mask to get the smallest NEURON_DATA_WIDTH bits
-      int masked = positive_ver & mask;
-      // re-introduce sign
-      output[i] = positive ? masked : -masked;
+      // activation function (ReLU)
+      int value = activate ? std::max(0, output[i]) : output[i];
+      // arithmetic shift, then keep the smallest NEURON_DATA_WIDTH bits of the magnitude
+      value >>= SUM_TO_LOGIC_SHIFT;
+      output[i] = value >= 0 ? (value & NEURON_MASK) : -(-value & NEURON_MASK);
     }
   }
 };
@@ -81,8 +118,9 @@ template <int hidden_size, int layer_count> struct StaticPLNet {
 
   void init(std::mt19937 &rng) {
     // just init each layer individually
+    mutation::Rng fast(rng);
     for (int i = 0; i < layer_count; ++i) {
-      layers[i].init(rng);
+      layers[i].init(fast);
     }
   }
 
@@ -130,11 +168,16 @@ template <int hidden_size, int layer_count> struct StaticPLNet {
   }
 
   void mutate(std::mt19937 &rng, float mutation_rate) {
-    // mutate all layers
+    // mutate all layers from one fast generator
+    mutation::Rng fast(rng);
     for (int i = 0; i < layer_count; ++i) {
-      layers[i].mutate(rng, mutation_rate);
+      layers[i].mutate(fast, mutation_rate);
     }
   }
+
+  uint64_t hash(uint64_t h = PARAM_HASH_SEED) const {
+    return hash_bytes(h, layers, sizeof(layers));
+  }
 };
 
 } // namespace model
@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "game.h"
@@ -9,9 +10,11 @@
 #include "pixel_game.h"
 #include "models/human.h"
 
+// replay_filename, if given, records the episode from the current frame on
 template <typename ObsType>
 std::vector<int> play(Game<ObsType> &game,
-                      const std::vector<std::shared_ptr<model::Model<ObsType>>> &models) {
+                      const std::vector<std::shared_ptr<model::Model<ObsType>>> &models,
+                      const std::string &replay_filename = {}) {
   assert(game.get_player_count() == models.size());
 
   // build io vectors, fitness vector
@@ -24,6 +27,10 @@ std::vector<int> play(Game<ObsType> &game,
     outputs[i].resize(game.get_action_count());
   }
 
+  if (!replay_filename.empty()) {
+    game.begin_replay(replay_filename);
+  }
+
   // run the game until done
   while (!game.is_done()) {
     // observe the game state
@@ -38,6 +45,10 @@ std::vector<int> play(Game<ObsType> &game,
     game.update(outputs);
   }
 
+  if (!replay_filename.empty()) {
+    game.end_replay();
+  }
+
   // get the fitness
   game.get_fitness(fitness);
   return fitness;
@@ -46,7 +57,8 @@ std::vector<int> play(Game<ObsType> &game,
 template <typename ObsType>
 std::vector<int>
 play_and_render(Game<ObsType> &game,
-                const std::vector<std::shared_ptr<model::Model<ObsType>>> &models) {
+                const std::vector<std::shared_ptr<model::Model<ObsType>>> &models,
+                const std::string &replay_filename = {}) {
   assert(game.get_player_count() == models.size());
 
   // build io vectors, fitness vector
@@ -79,10 +91,10 @@ play_and_render(Game<ObsType> &game,
     }
   };
 
-  auto render_lambda = [&](std::vector<uint32_t> &pixels) {
+  auto render_lambda = [&](std::vector<uint32_t> &pixels, rendering::RenderTarget &target) {
     const auto res = game.get_resolution();
     pixels.resize(res.first * res.second);
-    game.render(pixels);
+    game.render(pixels, target);
     return res;
   };
 
@@ -118,7 +130,17 @@ play_and_render(Game<ObsType> &game,
     }
   };
 
-  window.run(update_lambda, render_lambda, handle_input_lambda);
+  if (!replay_filename.empty()) {
+    game.begin_replay(replay_filename);
+  }
+
+  // the simulation runs on its own thread, so play can be fast-forwarded from the overlay
+  window.run_decoupled(update_lambda, render_lambda, handle_input_lambda);
+
+  // also covers the window being closed early
+  if (!replay_filename.empty()) {
+    game.end_replay();
+  }
 
   game.get_fitness(fitness);
   return fitness;
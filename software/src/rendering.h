@@ -1,11 +1,28 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <utility>
 #include <vector>
 
 namespace rendering {
 
+// a region of a pixel buffer, x and y from the top left
+struct Rect {
+  int x, y, w, h;
+};
+
+// what a game last drew into one caller-owned pixel buffer. rendering into that buffer again
+// with the same target only redraws where the previous frame drew; a default constructed target
+// gets the whole frame. keep one per buffer, and reset it if anything else writes to the buffer.
+struct RenderTarget {
+  static constexpr int MAX_DIRTY = 8;
+
+  const void *source{nullptr}; // identifies what the buffer was drawn over
+  std::array<Rect, MAX_DIRTY> dirty{};
+  int dirty_count{0};
+};
+
 uint32_t make_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
 
 void draw_tile(std::vector<uint32_t> &pixels, std::pair<int, int> pixels_res,
@@ -1,11 +1,17 @@
 #include "training.h"
 
+#include "episode_export.h"
 #include "games/jnb.h"
 #include "models/mlp_simple.h"
 #include "observation_types.h"
 #include "optimizers/ga_funs.h"
+#include "optimizers/ga_jnb.h"
 
+#include <algorithm>
+#include <iostream>
+#include <memory>
 #include <random>
+#include <string>
 
 using namespace ga;
 
@@ -21,17 +27,42 @@ void train(const std::string &map_filename) {
     return new_model;
   };
 
+  State<obs::Simple> state;
+  // every few generations, record the best solution against the first reference in the
+  // background, without slowing training down
+  constexpr size_t EXPORT_INTERVAL = 8;
+  auto exporter = std::make_shared<EpisodeExporter<obs::Simple>>();
+
   Config<obs::Simple> config;
   config.populate_fun = make_tournament<obs::Simple>(4);
-  config.fitness_fun = make_game_fitness_2p<obs::Simple>(std::make_shared<jnb::JnBGame>(game));
+  // tournament copies and fixed references replay known episodes, skip those
+  auto cache = std::make_shared<FitnessCache>();
+  // every episode of a generation in lockstep, with the population's nets stacked
+  config.population_fitness_fun =
+      make_jnb_fitness_2p_batched(game.get_map(), game.get_frame_limit(), 256, cache);
   config.model_builder = build_model;
   config.prior_best_select = make_tournament_prior_best<obs::Simple>(2);
-  config.fitness_logger = fitness_printer<obs::Simple>;
+  config.fitness_logger = [cache, exporter, &game, &state](size_t current_gen,
+                                                           const Population<obs::Simple> &pop) {
+    fitness_printer<obs::Simple>(current_gen, pop);
+    std::cout << "Fitness cache: " << cache->get_hits() << " hits, " << cache->get_misses()
+              << " misses" << std::endl;
+
+    if (current_gen % EXPORT_INTERVAL == 0 && !state.references.empty()) {
+      auto best = std::max_element(pop.begin(), pop.end(), [](const auto &a, const auto &b) {
+        return a.fitness < b.fitness;
+      });
+      game.init(current_gen);
+      const std::string directory = "episodes/gen_" + std::to_string(current_gen);
+      if (!exporter->submit(game, {best->model, state.references[0]}, directory)) {
+        std::cout << "Episode export queue full, skipped " << directory << std::endl;
+      }
+    }
+  };
 
   config.prior_best_size = 0;
   config.mutation_rate = 0.001f;
 
-  State<obs::Simple> state;
   init(state, config);
   run(state, config);
 }
@@ -0,0 +1,161 @@
+// port of fpga/src/imports/xormix32.vhd (https://github.com/MaartenBaert/xormix),
+// so the CPU can draw exactly the same random numbers as the PL.
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+namespace jnb {
+
+namespace xormix32_detail {
+
+// state_x(i) is the xor of the state_x bits set in X_TAPS[i]
+constexpr std::array<uint32_t, 32> X_TAPS = {
+    0x01480808, 0x16100084, 0x01040130, 0x04604180, 0x47004000, 0x00232420, 0x23004800,
+    0x8C4000A0, 0x00060103, 0x24202009, 0x20A80400, 0x001C8410, 0x31080010, 0x080818C0,
+    0x4200002A, 0x10401882, 0x20014024, 0x85800101, 0x00028250, 0x40040A44, 0x08109004,
+    0x80300442, 0x28018200, 0xE0002408, 0x81820040, 0x00090350, 0x10C08040, 0x50048600,
+    0x12181000, 0x00006701, 0x08C02008, 0x00831006};
+
+constexpr std::array<uint32_t, 32> SALTS = {
+    0x198F8D32, 0x46D9B8AC, 0x57F90206, 0xCB246290, 0x5FDA94C2, 0xB9969E83, 0x990053FE,
+    0x0CEF1F8B, 0x9BAAFEFA, 0x232B8463, 0x0FC77197, 0xD113A2D8, 0xD6C99EF7, 0xF3FB7189,
+    0x9CEEB1DD, 0x352DF180, 0xFEED780C, 0xEE211518, 0x3AFACA18, 0x95F13C50, 0xD8449F2A,
+    0x59752549, 0x854F0980, 0x234A07B4, 0x51C0C69B, 0xA71D489E, 0x618CBC79, 0xAB0E51E1,
+    0x965C4507, 0xE90488A4, 0x73674EB7, 0x00AF1456};
+
+// result bit j of each mixing round takes mixin bit (stream + offset[j]) mod 32
+constexpr std::array<int, 16> MIXIN_OFFSETS_1 = {15, 29, 5,  0,  16, 9,  26, 14,
+                                                 13, 10, 19, 11, 2,  6,  8,  17};
+constexpr std::array<int, 16> MIXIN_OFFSETS_2 = {20, 4,  22, 30, 31, 21, 24, 25,
+                                                 18, 27, 28, 23, 12, 7,  1,  3};
+
+// the state_x update is linear over GF(2), so it splits into one lookup per input byte
+constexpr std::array<std::array<uint32_t, 256>, 4> make_x_tables() {
+  std::array<std::array<uint32_t, 256>, 4> tables{};
+  for (int byte = 0; byte < 4; ++byte) {
+    for (uint32_t value = 0; value < 256; ++value) {
+      const uint32_t x = value << (8 * byte);
+      uint32_t next_x = 0;
+      for (int i = 0; i < 32; ++i) {
+        next_x |= static_cast<uint32_t>(std::popcount(x & X_TAPS[i]) & 1) << i;
+      }
+      tables[byte][value] = next_x;
+    }
+  }
+  return tables;
+}
+
+// same for the mixin bit shuffles of one stream. the low half of each entry is the first
+// round's shuffle, the high half is the second round's.
+constexpr std::array<std::array<uint32_t, 256>, 4> make_mixin_tables(int stream) {
+  std::array<std::array<uint32_t, 256>, 4> tables{};
+  for (int byte = 0; byte < 4; ++byte) {
+    for (uint32_t value = 0; value < 256; ++value) {
+      const uint32_t mixin = value << (8 * byte);
+      uint32_t res = 0;
+      for (int j = 0; j < 16; ++j) {
+        res |= ((mixin >> ((stream + MIXIN_OFFSETS_1[j]) % 32)) & 1) << j;
+        res |= ((mixin >> ((stream + MIXIN_OFFSETS_2[j]) % 32)) & 1) << (j + 16);
+      }
+      tables[byte][value] = res;
+    }
+  }
+  return tables;
+}
+
+constexpr uint32_t lookup_bytes(const std::array<std::array<uint32_t, 256>, 4> &tables,
+                                uint32_t value) {
+  return tables[0][value & 0xFF] ^ tables[1][(value >> 8) & 0xFF] ^
+         tables[2][(value >> 16) & 0xFF] ^ tables[3][value >> 24];
+}
+
+template <int STREAMS>
+constexpr auto make_all_mixin_tables() {
+  std::array<std::array<std::array<uint32_t, 256>, 4>, STREAMS> tables{};
+  for (int i = 0; i < STREAMS; ++i) {
+    tables[i] = make_mixin_tables(i);
+  }
+  return tables;
+}
+
+// the shuffles are linear too, so the salt's share of the mixin is a constant per stream
+template <int STREAMS>
+constexpr auto make_salt_mixins() {
+  std::array<uint32_t, STREAMS> salt_mixins{};
+  for (int i = 0; i < STREAMS; ++i) {
+    salt_mixins[i] = lookup_bytes(make_mixin_tables(i), SALTS[i]);
+  }
+  return salt_mixins;
+}
+
+constexpr auto X_TABLES = make_x_tables();
+
+// one mixing round for one stream, given that stream's shuffled mixin bits.
+// returns the new upper 16 bits:
+// mixup(j) ^ (mixup(j + 6) & !mixup(j + 16)) ^ mixup(j + 9) ^ mixup(j + 15) ^ mixin bit
+constexpr uint32_t mix(uint32_t mixup, uint32_t mixin_bits) {
+  const uint32_t res = mixup ^ ((mixup >> 6) & ~(mixup >> 16)) ^ (mixup >> 9) ^ (mixup >> 15);
+  return (res ^ mixin_bits) & 0xFFFF;
+}
+
+} // namespace xormix32_detail
+
+// xormix32 with STREAMS independent 32-bit outputs per step. 4 * (STREAMS + 1) bytes of
+// trivially copyable state.
+template <int STREAMS>
+class Xormix32 {
+  static_assert(STREAMS >= 1 && STREAMS <= 32, "xormix32 supports 1 to 32 streams");
+
+public:
+  constexpr Xormix32() = default;
+  constexpr explicit Xormix32(uint32_t seed_x, const std::array<uint32_t, STREAMS> &seed_y = {}) {
+    seed(seed_x, seed_y);
+  }
+
+  // same as holding rst high for a cycle
+  constexpr void seed(uint32_t seed_x, const std::array<uint32_t, STREAMS> &seed_y = {}) {
+    state_x = seed_x;
+    state_y = seed_y;
+  }
+
+  // same as one clock cycle with enable high
+  constexpr void advance() {
+    using namespace xormix32_detail;
+
+    // both rounds mix in the old state_x, the second one mixes up the output of the first
+    std::array<uint32_t, STREAMS> mixin{};
+    for (int i = 0; i < STREAMS; ++i) {
+      mixin[i] = lookup_bytes(MIXIN_TABLES[i], state_x) ^ SALT_MIXINS[i];
+    }
+    std::array<uint32_t, STREAMS> half{};
+    for (int i = 0; i < STREAMS; ++i) {
+      const uint32_t res = mix(state_y[(i + 1) % STREAMS], mixin[i]);
+      half[i] = (res << 16) | (state_y[i] >> 16);
+    }
+    for (int i = 0; i < STREAMS; ++i) {
+      const uint32_t res = mix(half[(i + 1) % STREAMS], mixin[i] >> 16);
+      state_y[i] = (res << 16) | (half[i] >> 16);
+    }
+
+    state_x = lookup_bytes(X_TABLES, state_x);
+  }
+
+  // the result port, one 32-bit word per stream
+  constexpr uint32_t result(int stream) const {
+    return state_y[stream];
+  }
+
+  constexpr bool operator==(const Xormix32 &other) const = default;
+
+private:
+  static constexpr auto MIXIN_TABLES = xormix32_detail::make_all_mixin_tables<STREAMS>();
+  static constexpr auto SALT_MIXINS = xormix32_detail::make_salt_mixins<STREAMS>();
+
+  uint32_t state_x{0};
+  std::array<uint32_t, STREAMS> state_y{};
+};
+
+} // namespace jnb